@@ -0,0 +1,188 @@
+use std::fs;
+use std::hint::black_box;
+use std::path::Path;
+use std::process::ExitCode;
+use std::time::Instant;
+use emuiibo_amiibo::bin::{self, Buffer};
+use emuiibo_amiibo::compat;
+use emuiibo_amiibo::util::ArrayString;
+
+// Bulk raw dump conversion throughput (emuiibo's actual key derivation and decryption), printed as JSON
+// Compares reloading the retail keys for every dump (what emuiibo used to do) against a key context shared by every conversion
+
+const DEFAULT_DUMP_COUNT: usize = 500;
+const SAMPLE_COUNT: usize = 15;
+
+struct Options {
+    dump_count: usize,
+    output_path: Option<String>
+}
+
+struct BenchResult {
+    name: &'static str,
+    ops_per_sample: usize,
+    sample_ns_per_op: Vec<f64>
+}
+
+fn run_bench<F: FnMut()>(results: &mut Vec<BenchResult>, name: &'static str, ops_per_sample: usize, mut bench_fn: F) {
+    // Warm-up run, not measured
+    bench_fn();
+
+    let mut result = BenchResult { name, ops_per_sample, sample_ns_per_op: Vec::with_capacity(SAMPLE_COUNT) };
+    for _ in 0..SAMPLE_COUNT {
+        let start = Instant::now();
+        bench_fn();
+        result.sample_ns_per_op.push(start.elapsed().as_nanos() as f64 / ops_per_sample as f64);
+    }
+    eprintln!("  {:<40} done", name);
+    results.push(result);
+}
+
+fn make_results_json(opts: &Options, results: &[BenchResult]) -> String {
+    let benchs_json: Vec<String> = results.iter().map(|result| {
+        let mut sorted = result.sample_ns_per_op.clone();
+        sorted.sort_by(f64::total_cmp);
+        let median = sorted[sorted.len() / 2];
+        let mean = sorted.iter().sum::<f64>() / sorted.len() as f64;
+        format!("        {{\n            \"name\": \"{}\",\n            \"ops_per_sample\": {},\n            \"ns_per_op_min\": {},\n            \"ns_per_op_median\": {},\n            \"ns_per_op_mean\": {},\n            \"ns_per_op_max\": {},\n            \"ops_per_sec\": {}\n        }}",
+            result.name, result.ops_per_sample, sorted[0], median, mean, sorted[sorted.len() - 1], 1_000_000_000.0 / median)
+    }).collect();
+
+    format!("{{\n    \"version\": \"{}\",\n    \"dump_count\": {},\n    \"samples\": {},\n    \"benchmarks\": [\n{}\n    ]\n}}",
+        env!("CARGO_PKG_VERSION"), opts.dump_count, SAMPLE_COUNT, benchs_json.join(",\n"))
+}
+
+// xorshift64*, with a fixed seed so that runs are comparable
+struct Rng(u64);
+
+impl Rng {
+    fn fill(&mut self, buf: &mut [u8]) {
+        for byte in buf.iter_mut() {
+            self.0 ^= self.0 >> 12;
+            self.0 ^= self.0 << 25;
+            self.0 ^= self.0 >> 27;
+            *byte = (self.0.wrapping_mul(0x2545F4914F6CDD1D) >> 56) as u8;
+        }
+    }
+}
+
+fn make_synthetic_key_set(rng: &mut Rng) -> bin::RetailKeySet {
+    // Random keys with the real phrases and seed sizes, which is all that matters for the derivation's cost
+    let mut key_set: bin::RetailKeySet = Default::default();
+    rng.fill(key_set.get_buf_mut());
+    key_set.data_key.phrase = ArrayString::from_str("unfixed infos");
+    key_set.data_key.seed_size = 0xE;
+    key_set.tag_key.phrase = ArrayString::from_str("locked secret");
+    key_set.tag_key.seed_size = 0x10;
+    key_set
+}
+
+fn make_synthetic_dump(rng: &mut Rng) -> bin::ConvertedFormat {
+    // Loaded like v1 virtual amiibos are
+    let mut raw_bin: bin::RawFormat = Default::default();
+    rng.fill(raw_bin.get_buf_mut());
+    bin::ConvertedFormat::from_raw(&raw_bin)
+}
+
+fn load_retail_key_set(path: &Path) -> bin::RetailKeySetContext {
+    let key_set_data = fs::read(path).expect("the synthetic key set was just written");
+    bin::RetailKeySetContext::new(&bin::RetailKeySet::from_bytes(&key_set_data).expect("the synthetic key set was just written"))
+}
+
+fn derive_keys(key_set: &bin::RetailKeySetContext, dump: &bin::ConvertedFormat) -> bin::DerivedKeySet {
+    let base_seed = bin::KeyDerivationSeed::from_converted(dump);
+    bin::DerivedKeySet::derive_from(key_set, base_seed.get_buf()).unwrap()
+}
+
+fn decrypt(key_set: &bin::RetailKeySetContext, dump: &bin::ConvertedFormat) -> bin::PlainFormat {
+    bin::PlainFormat::decrypt_from_converted(dump, key_set).unwrap()
+}
+
+fn run_conversion_benchs(results: &mut Vec<BenchResult>, dumps: &[bin::ConvertedFormat], key_set_path: &Path) {
+    run_bench(results, "derive_keys_reload_per_dump", dumps.len(), || {
+        for dump in dumps {
+            let key_set = load_retail_key_set(key_set_path);
+            black_box(derive_keys(&key_set, dump));
+        }
+    });
+
+    run_bench(results, "derive_keys_shared_context", dumps.len(), || {
+        let key_set = load_retail_key_set(key_set_path);
+        for dump in dumps {
+            black_box(derive_keys(&key_set, dump));
+        }
+    });
+
+    run_bench(results, "decrypt_reload_per_dump", dumps.len(), || {
+        for dump in dumps {
+            let key_set = load_retail_key_set(key_set_path);
+            black_box(decrypt(&key_set, dump));
+        }
+    });
+
+    run_bench(results, "decrypt_shared_context", dumps.len(), || {
+        let key_set = load_retail_key_set(key_set_path);
+        for dump in dumps {
+            black_box(decrypt(&key_set, dump));
+        }
+    });
+}
+
+fn parse_options(args: &[String]) -> Option<Options> {
+    let mut opts = Options { dump_count: DEFAULT_DUMP_COUNT, output_path: None };
+
+    let mut args_iter = args.iter();
+    while let Some(arg) = args_iter.next() {
+        match arg.as_str() {
+            // Always passed by cargo bench
+            "--bench" => {},
+            "--dumps" => opts.dump_count = args_iter.next()?.parse().ok()?,
+            "--output" => opts.output_path = Some(args_iter.next()?.clone()),
+            _ => return None
+        }
+    }
+
+    match opts.dump_count {
+        0 => None,
+        _ => Some(opts)
+    }
+}
+
+fn main() -> ExitCode {
+    let args: Vec<String> = std::env::args().collect();
+    let Some(opts) = parse_options(&args[1..]) else {
+        eprintln!("Usage: cargo bench --bench key_derivation -- [--dumps <count>] [--output <json-file>]");
+        return ExitCode::FAILURE;
+    };
+
+    let tmp_dir = std::env::temp_dir().join(format!("emuiibo-keybench-{}", std::process::id()));
+    if let Err(err) = fs::create_dir_all(&tmp_dir) {
+        eprintln!("Unable to create the temporary directory: {}", err);
+        return ExitCode::FAILURE;
+    }
+
+    let mut rng = Rng(0x352);
+    let key_set_path = tmp_dir.join(compat::RETAIL_KEY_SET_FILE_NAME);
+    if let Err(err) = fs::write(&key_set_path, make_synthetic_key_set(&mut rng).get_buf()) {
+        eprintln!("Unable to write the synthetic key set: {}", err);
+        return ExitCode::FAILURE;
+    }
+
+    eprintln!("Generating {} raw dumps...", opts.dump_count);
+    let dumps: Vec<bin::ConvertedFormat> = (0..opts.dump_count).map(|_| make_synthetic_dump(&mut rng)).collect();
+
+    eprintln!("Running benchmarks...");
+    let mut results = Vec::new();
+    run_conversion_benchs(&mut results, &dumps, &key_set_path);
+    let _ = fs::remove_dir_all(&tmp_dir);
+
+    let results_json = make_results_json(&opts, &results);
+    if let Some(output_path) = opts.output_path.as_ref() {
+        if let Err(err) = fs::write(output_path, format!("{}\n", results_json)) {
+            eprintln!("Unable to write '{}': {}", output_path, err);
+            return ExitCode::FAILURE;
+        }
+    }
+    println!("{}", results_json);
+    ExitCode::SUCCESS
+}
@@ -1,16 +1,9 @@
 use aes::cipher::KeyIvInit;
 use aes::cipher::StreamCipher;
 use alloc::string::String;
-use alloc::vec::Vec;
 use hmac::digest::FixedOutput;
-use nx::service::mii;
-use nx::svc::rc::ResultInvalidSize;
-use nx::util;
-use nx::rand::RngCore;
-use nx::result::*;
-use nx::util::Uuid;
-use crate::fsext;
-use crate::miiext;
+use crate::platform::{ErrorKind, Platform};
+use crate::util;
 use super::ntag::Manufacturer1;
 use super::ntag::Manufacturer2;
 use super::{ntag, fmt};
@@ -18,6 +11,9 @@ use super::{ntag, fmt};
 use sha2::Sha256;
 use hmac::{Hmac, Mac};
 
+// Note: nothing here depends on the platform (see to_virtual_amiibo), so failures are just reported as the error kind
+type Result<T> = core::result::Result<T, ErrorKind>;
+
 type Aes128Ctr= ctr::Ctr128LE<aes::Aes128>;
 type HmacSha256 = Hmac<Sha256>;
 
@@ -36,7 +32,8 @@ pub trait Buffer: Sized {
 }
 
 pub struct DrbgContext {
-    pub hmac_key: Vec<u8>,
+    // Already keyed (see RetailKeyContext), cloned for every step
+    pub hmac: HmacSha256,
     pub iteration: u16,
     pub buf: [u8; core::mem::size_of::<u16>() + Self::MAX_SEED_SIZE],
     pub buf_size: usize
@@ -45,9 +42,9 @@ pub struct DrbgContext {
 impl DrbgContext {
     pub const MAX_SEED_SIZE: usize = 480;
 
-    pub fn new(hmac_key: &[u8], seed: &[u8]) -> Result<Self> {
+    pub fn new(hmac: &HmacSha256, seed: &[u8]) -> Result<Self> {
         let mut ctx = Self {
-            hmac_key: hmac_key.to_vec(),
+            hmac: hmac.clone(),
             iteration: 0,
             buf: [0; core::mem::size_of::<u16>() + Self::MAX_SEED_SIZE],
             buf_size: core::mem::size_of::<u16>() + seed.len().min(Self::MAX_SEED_SIZE)
@@ -66,14 +63,14 @@ impl DrbgContext {
         }
         self.iteration += 1;
 
-        let mut mac = HmacSha256::new_from_slice(&self.hmac_key).expect("HMAC-SHA256 allows keys of any size");
+        let mut mac = self.hmac.clone();
         mac.update(&self.buf[0..self.buf_size]);
         mac.finalize_into(out_mac.into());
         Ok(())
     }
 
-    pub fn gen_bytes(hmac_key: &[u8], seed: &[u8], out_data: &mut [u8]) -> Result<()> {
-        let mut ctx = Self::new(hmac_key, seed)?;
+    pub fn gen_bytes(hmac: &HmacSha256, seed: &[u8], out_data: &mut [u8]) -> Result<()> {
+        let mut ctx = Self::new(hmac, seed)?;
 
         let mut remaining_size = out_data.len();
         let mut cur_buf = out_data.as_mut_ptr();
@@ -110,6 +107,27 @@ impl RetailKey {
     pub const MAX_SEED_SIZE: usize = 0x10;
 }
 
+// A retail key with its HMAC key setup already done: created once and reused for every conversion, instead of redoing the setup for every DRBG step of every dump
+#[derive(Clone)]
+pub struct RetailKeyContext {
+    pub key: RetailKey,
+    hmac: HmacSha256
+}
+
+impl RetailKeyContext {
+    pub fn new(key: &RetailKey) -> Self {
+        Self {
+            key: *key,
+            hmac: HmacSha256::new_from_slice(&key.hmac_key).expect("HMAC-SHA256 allows keys of any size")
+        }
+    }
+
+    #[inline]
+    pub fn new_hmac(&self) -> HmacSha256 {
+        self.hmac.clone()
+    }
+}
+
 #[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
 #[repr(C,)]
 pub struct DerivedKey {
@@ -122,7 +140,8 @@ const_assert!(core::mem::size_of::<DerivedKey>() == 0x30);
 impl Buffer for DerivedKey {}
 
 impl DerivedKey {
-    pub fn derive_from(key: &RetailKey, base_seed: &[u8]) -> Result<Self> {
+    pub fn derive_from(key_ctx: &RetailKeyContext, base_seed: &[u8]) -> Result<Self> {
+        let key = &key_ctx.key;
         let mut prepared_seed = [0u8; DrbgContext::MAX_SEED_SIZE];
 
         let prepared_seed_buf_start = prepared_seed.as_mut_ptr();
@@ -152,7 +171,7 @@ impl DerivedKey {
 
             let prepared_seed_size = prepared_seed_buf_cursor.offset_from(prepared_seed_buf_start) as usize;
             let mut derived_key: Self = Default::default();
-            DrbgContext::gen_bytes(&key.hmac_key, &prepared_seed[0..prepared_seed_size], derived_key.get_buf_mut())?;
+            DrbgContext::gen_bytes(&key_ctx.hmac, &prepared_seed[0..prepared_seed_size], derived_key.get_buf_mut())?;
 
             Ok(derived_key)
         }
@@ -167,6 +186,34 @@ pub struct RetailKeySet {
 }
 const_assert!(core::mem::size_of::<RetailKeySet>() == 2 * core::mem::size_of::<RetailKey>());
 
+impl Buffer for RetailKeySet {}
+
+impl RetailKeySet {
+    // From key_retail.bin's contents
+    pub fn from_bytes(data: &[u8]) -> Option<Self> {
+        let mut key_set: Self = Default::default();
+        let key_set_buf = key_set.get_buf_mut();
+        let key_set_data = data.get(..key_set_buf.len())?;
+        key_set_buf.copy_from_slice(key_set_data);
+        Some(key_set)
+    }
+}
+
+#[derive(Clone)]
+pub struct RetailKeySetContext {
+    pub data_key: RetailKeyContext,
+    pub tag_key: RetailKeyContext
+}
+
+impl RetailKeySetContext {
+    pub fn new(key_set: &RetailKeySet) -> Self {
+        Self {
+            data_key: RetailKeyContext::new(&key_set.data_key),
+            tag_key: RetailKeyContext::new(&key_set.tag_key)
+        }
+    }
+}
+
 #[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
 #[repr(C)]
 pub struct DerivedKeySet {
@@ -177,7 +224,7 @@ const_assert!(core::mem::size_of::<DerivedKeySet>() == 2 * core::mem::size_of::<
 
 impl DerivedKeySet {
     #[inline]
-    pub fn derive_from(key_set: &RetailKeySet, base_seed: &[u8]) -> Result<Self> {
+    pub fn derive_from(key_set: &RetailKeySetContext, base_seed: &[u8]) -> Result<Self> {
         Ok(Self {
             data_key: DerivedKey::derive_from(&key_set.data_key, base_seed)?,
             tag_key: DerivedKey::derive_from(&key_set.tag_key, base_seed)?
@@ -234,7 +281,7 @@ const_assert!(core::mem::size_of::<Struct1>() == 0x2C);
 #[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
 #[repr(C)]
 pub struct Struct2 {
-    pub unk_0xa5: u8,
+    pub unk_0xa5: u8, // Always 0xA5 in actual dumps
     pub unk_1: u8,
     pub write_counter: u8,
     pub unk_2: u8
@@ -1073,77 +1120,14 @@ impl MiiFormat {
     pub fn set_mole_type(&mut self, m_type: u8) {
         write_bits!(15, 15, self.mole_info_bf, m_type as u16);
     }
-
-    pub unsafe fn to_charinfo(&self) -> Result<mii::CharInfo> {
-        Ok(mii::CharInfo {
-            id: {
-                let mut uuid: Uuid = Default::default();
-                nx::rand::get_rng()?.fill_bytes(&mut uuid.uuid);
-                uuid
-            },
-            name: {
-                let name = self.name;
-                util::ArrayWideString::from_string(name.get_string()?)
-            },
-            font_region: mii::FontRegion::Standard,
-            faceline_color: core::mem::transmute(self.get_favorite_color()),
-            gender: core::mem::transmute(self.get_gender()),
-            height: self.height,
-            build: self.build,
-            type_val: 0,
-            region_move: !self.get_disable_sharing_flag() as u8,
-            faceline_type: core::mem::transmute(self.get_faceline_type()),
-            favorite_color: self.get_faceline_color(),
-            faceline_wrinkle: core::mem::transmute(self.get_faceline_wrinkle()),
-            faceline_make: core::mem::transmute(self.get_faceline_make()),
-            hair_type: core::mem::transmute(self.hair_type),
-            hair_color: self.get_hair_color(),
-            hair_flip: core::mem::transmute(self.get_hair_flip()),
-            eye_type: core::mem::transmute(self.get_eye_type()),
-            eye_color: self.get_eye_color(),
-            eye_scale: self.get_eye_scale(),
-            eye_aspect: self.get_eye_aspect(),
-            eye_rotate: self.get_eye_rotate(),
-            eye_x: self.get_eye_x(),
-            eye_y: self.get_eye_y(),
-            eyebrow_type: core::mem::transmute(self.get_eyebrow_type()),
-            eyebrow_color: self.get_eyebrow_color(),
-            eyebrow_scale: self.get_eyebrow_scale(),
-            eyebrow_aspect: self.get_eyebrow_aspect(),
-            eyebrow_rotate: self.get_eyebrow_rotate(),
-            eyebrow_x: self.get_eyebrow_x(),
-            eyebrow_y: self.get_eyebrow_y(),
-            nose_type: core::mem::transmute(self.get_nose_type()),
-            nose_scale: self.get_nose_scale(),
-            nose_y: self.get_nose_y(),
-            mouth_type: core::mem::transmute(self.get_mouth_type()),
-            mouth_color: self.get_mouth_color(),
-            mouth_scale: self.get_mouth_scale(),
-            mouth_aspect: self.get_mouth_aspect(),
-            mouth_y: self.get_mouth_y(),
-            beard_color: self.get_beard_color(),
-            beard_type: core::mem::transmute(self.get_beard_type()),
-            mustache_type: core::mem::transmute(self.get_mustache_type()),
-            mustache_scale: self.get_mustache_scale(),
-            mustache_y: self.get_mustache_y(),
-            glass_type: core::mem::transmute(self.get_glass_type()),
-            glass_color: self.get_glass_color(),
-            glass_scale: self.get_glass_scale(),
-            glass_y: self.get_glass_y(),
-            mole_type: core::mem::transmute(self.get_mole_type()),
-            mole_scale: self.get_mole_scale(),
-            mole_x: self.get_mole_x(),
-            mole_y: self.get_mole_y(),
-            reserved: 0
-        })
-    }
 }
 
 #[derive(Copy, Clone, PartialEq, Eq, Debug)]
 #[repr(C, packed)]
 pub struct Settings {
     pub flags: Flags,
-    pub country_code: CountryCode,
+    // Not a CountryCode: decrypted dumps can contain any value, and an invalid enum value is UB
+    pub country_code: u8,
     pub crc32_write_counter_be: u16,
     pub first_write_date_be: Date,
     pub last_write_date_be: Date,
@@ -1165,7 +1149,7 @@ impl Default for Settings {
     fn default() -> Self {
         Self {
             flags: Flags::None(),
-            country_code: CountryCode::Spain,
+            country_code: CountryCode::Spain as u8,
             crc32_write_counter_be: 0,
             first_write_date_be: DEFAULT_SETTINGS_WRITE_DATE,
             last_write_date_be: DEFAULT_SETTINGS_WRITE_DATE,
@@ -1238,6 +1222,8 @@ pub struct RawFormat {
 }
 const_assert!(core::mem::size_of::<RawFormat>() == 532);
 
+impl Buffer for RawFormat {}
+
 impl Default for RawFormat {
     fn default() -> Self {
         Self {
@@ -1269,6 +1255,8 @@ pub struct ConvertedFormat {
 }
 const_assert!(core::mem::size_of::<ConvertedFormat>() == 520);
 
+impl Buffer for ConvertedFormat {}
+
 impl ConvertedFormat {
     pub const fn from_raw(raw: &RawFormat) -> Self {
         Self {
@@ -1300,6 +1288,8 @@ pub struct PlainFormat {
 }
 const_assert!(core::mem::size_of::<ConvertedFormat>() == core::mem::size_of::<PlainFormat>());
 
+impl Buffer for PlainFormat {}
+
 impl PlainFormat {
     pub fn from_converted(conv: &ConvertedFormat) -> Self {
         // Sets everything except for encrypted sections
@@ -1314,7 +1304,7 @@ impl PlainFormat {
         }
     }
 
-    pub fn decrypt_from_converted(conv: &ConvertedFormat, key_set: &RetailKeySet) -> Result<Self> {
+    pub fn decrypt_from_converted(conv: &ConvertedFormat, key_set: &RetailKeySetContext) -> Result<Self> {
         // Convert non-encrypted parts
         let mut plain_bin = Self::from_converted(conv);
 
@@ -1324,14 +1314,14 @@ impl PlainFormat {
         let derived_key_set = DerivedKeySet::derive_from(key_set, base_seed.get_buf())?;
 
         let mut aes_ctr_ctx = <Aes128Ctr as KeyIvInit>::new(&derived_key_set.data_key.aes_key.into(), &derived_key_set.data_key.aes_iv.into());
-        aes_ctr_ctx.apply_keystream_b2b(conv.enc_data.get_buf(), plain_bin.dec_data.get_buf_mut()).map_err(|_| ResultInvalidSize::make())?;
+        aes_ctr_ctx.apply_keystream_b2b(conv.enc_data.get_buf(), plain_bin.dec_data.get_buf_mut()).map_err(|_| ErrorKind::InvalidSize)?;
 
         if plain_bin.dec_data.settings.flags == Flags::None() {
             // Dumps with this set to none might be from retail amiibos with no usage, thus the rest of settings might be garbage data
             plain_bin.dec_data.settings = Default::default();
         }
 
-        let mut mac = HmacSha256::new_from_slice(&key_set.tag_key.hmac_key).unwrap();
+        let mut mac = key_set.tag_key.new_hmac();
         let tag_data_start = &plain_bin.man_info_1 as *const _ as *const u8;
         let tag_data_size = core::mem::size_of::<Manufacturer1>() + core::mem::size_of::<Struct1>();
         let tag_data = unsafe {
@@ -1346,7 +1336,7 @@ impl PlainFormat {
             core::slice::from_raw_parts(data_data_start, data_data_size)
         };
 
-        let mut mac = HmacSha256::new_from_slice(&key_set.tag_key.hmac_key).unwrap();
+        let mut mac = key_set.tag_key.new_hmac();
         mac.update(data_data);
         mac.finalize_into(&mut plain_bin.data_sha256_hmac_hash.into());
 
@@ -1356,10 +1346,10 @@ impl PlainFormat {
         Ok(plain_bin)
     }
 
-    pub fn to_virtual_amiibo(&self, path: String, mii_charinfo_file: String) -> Result<fmt::VirtualAmiibo> {
+    pub fn to_virtual_amiibo<P: Platform>(&self, platform: &P, path: String, mii_charinfo_file: String) -> crate::Result<P, fmt::ConvertedVirtualAmiibo> {
         // Note: doing all the apparently redundant let-s to silence packed-field-access warnings 
 
-        Ok(fmt::VirtualAmiibo {
+        Ok(fmt::ConvertedVirtualAmiibo {
             info: fmt::VirtualAmiiboInfo {
                 first_write_date: {
                     let first_write_date_be = self.dec_data.settings.first_write_date_be;
@@ -1379,9 +1369,9 @@ impl PlainFormat {
                 mii_charinfo_file,
                 name: {
                     let name_be = self.dec_data.settings.name_be;
-                    let name_str = name_be.get_string()?;
+                    let name_str = name_be.get_string();
                     if name_str.is_empty() {
-                        fsext::get_path_file_name(&path)
+                        util::get_path_file_name(&path)
                     }
                     else {
                         name_str
@@ -1406,7 +1396,7 @@ impl PlainFormat {
                     write_counter_be.swap_bytes()
                 }
             },
-            mii_charinfo: miiext::generate_random_mii()?, // TODO: convert from 3DS format! meanwhile set a random mii
+            mii_charinfo: platform.generate_random_mii()?, // TODO: convert from 3DS format! meanwhile set a random mii
             areas: {
                 let flags = self.dec_data.settings.flags; 
                 let access_id_be = self.dec_data.settings.access_id_be;
@@ -0,0 +1,44 @@
+use alloc::string::String;
+use crate::platform::{Platform, Result};
+use super::{bin, fmt};
+
+pub const RETAIL_KEY_SET_FILE_NAME: &str = "key_retail.bin";
+
+pub trait DeprecatedVirtualAmiiboFormat: Sized {
+    fn try_load<P: Platform>(platform: &P, path: String) -> Result<P, Self>;
+
+    fn get_path(&self) -> &str;
+
+    // Name of the converted virtual amiibo (see find_convert_path)
+    fn get_convert_name(&self) -> String;
+
+    // Converts it into the given virtual amiibo directory (which might be the deprecated one's), callers converting in parallel pick it themselves
+    fn convert_to<P: Platform>(&self, platform: &P, key_set: Option<&bin::RetailKeySetContext>, path: String) -> Result<P, fmt::ConvertedVirtualAmiibo>;
+
+    fn convert<P: Platform>(&self, platform: &P, key_set: Option<&bin::RetailKeySetContext>, amiibo_dir: &str) -> Result<P, fmt::ConvertedVirtualAmiibo> {
+        let path = Self::find_convert_path(platform, amiibo_dir, self.get_path(), self.get_convert_name());
+        self.convert_to(platform, key_set, path)
+    }
+
+    fn find_convert_path<P: Platform>(platform: &P, amiibo_dir: &str, old_path: &str, name: String) -> String {
+        let mut path = format!("{}/{}", amiibo_dir, name);
+
+        if path == old_path {
+            return path;
+        }
+
+        let mut name_idx: usize = 0;
+        loop {
+            // Path already exists
+            if platform.exists(path.as_str()) {
+                name_idx += 1;
+                path = format!("{}/{}_{}", amiibo_dir, name, name_idx);
+            }
+            else {
+                break;
+            }
+        }
+
+        path
+    }
+}
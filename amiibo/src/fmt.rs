@@ -0,0 +1,254 @@
+use serde::{Serialize, Deserialize};
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::platform::Platform;
+use crate::util;
+
+// Current virtual amiibo format, used since emuiibo v0.5 (with slight modifications)
+// Only its files and how they get loaded/saved, emuiibo builds its runtime virtual amiibo (mii charinfo, nfp info...) on top of this
+
+// Note: actual amiibo ID in amiibos (nfp services have a different ID type)
+
+#[derive(Serialize, Deserialize, Clone, Debug)]
+pub struct VirtualAmiiboId {
+    pub game_character_id: u16,
+    pub character_variant: u8,
+    pub figure_type: u8,
+    pub model_number: u16,
+    pub series: u8
+}
+
+impl VirtualAmiiboId {
+    pub const fn empty() -> Self {
+        Self { character_variant: 0, figure_type: 0, game_character_id: 0, model_number: 0, series: 0 }
+    }
+}
+
+#[derive(Serialize, Deserialize, Copy, Clone, Debug)]
+pub struct VirtualAmiiboDate {
+    pub y: u16,
+    pub m: u8,
+    pub d: u8
+}
+
+#[derive(Serialize, Deserialize, Clone, Debug)]
+pub struct VirtualAmiiboInfo {
+    pub first_write_date: VirtualAmiiboDate,
+    pub id: VirtualAmiiboId,
+    pub last_write_date: VirtualAmiiboDate,
+    pub mii_charinfo_file: String,
+    pub name: String,
+    pub uuid: Vec<u8>,
+    pub use_random_uuid: bool,
+    pub version: u8,
+    pub write_counter: u16
+}
+
+// Note: temporary fix
+
+// Only the fields of amiibo.json needed for probing (serde skips the rest)
+
+#[derive(Deserialize, Clone, Debug)]
+pub struct VirtualAmiiboProbeInfo {
+    pub id: VirtualAmiiboId,
+    pub name: String
+}
+
+#[derive(Serialize, Deserialize, Clone, Debug)]
+pub struct VirtualAmiiboInfoOptional {
+    pub first_write_date: VirtualAmiiboDate,
+    pub id: VirtualAmiiboId,
+    pub last_write_date: VirtualAmiiboDate,
+    pub mii_charinfo_file: String,
+    pub name: String,
+    pub uuid: Option<Vec<u8>>,
+    pub use_random_uuid: Option<bool>,
+    pub version: u8,
+    pub write_counter: u16
+}
+
+impl VirtualAmiiboInfoOptional {
+    pub fn convert_to_info(self) -> VirtualAmiiboInfo {
+        VirtualAmiiboInfo {
+            first_write_date: self.first_write_date,
+            id: self.id,
+            last_write_date: self.last_write_date,
+            mii_charinfo_file: self.mii_charinfo_file,
+            name: self.name,
+            uuid: self.uuid.unwrap(),
+            use_random_uuid: self.use_random_uuid.unwrap(),
+            version: self.version,
+            write_counter: self.write_counter
+        }
+    }
+}
+
+#[derive(Copy, Clone, Serialize, Deserialize, Debug)]
+#[repr(C)]
+pub struct VirtualAmiiboAreaEntry {
+    pub program_id: u64,
+    pub access_id: u32
+}
+
+// Retail Interactive Display Menu (quite a symbolic ID)
+pub const DEFAULT_EMPTY_AREA_PROGRAM_ID: u64 = 0x0100069000078000;
+
+#[derive(Serialize, Deserialize, Clone, Debug)]
+pub struct VirtualAmiiboAreaInfo {
+    pub areas: Vec<VirtualAmiiboAreaEntry>,
+    pub current_area_access_id: u32
+}
+
+impl VirtualAmiiboAreaInfo {
+    pub const fn empty() -> Self {
+        Self {
+            areas: Vec::new(),
+            current_area_access_id: 0
+        }
+    }
+
+    pub fn has_area(&self, access_id: u32) -> bool {
+        self.areas.iter().any(|area_entry| area_entry.access_id == access_id)
+    }
+
+    pub fn register_area(&mut self, access_id: u32, program_id: u64) -> bool {
+        if self.has_area(access_id) {
+            false
+        }
+        else {
+            self.areas.push(VirtualAmiiboAreaEntry { program_id, access_id });
+            true
+        }
+    }
+}
+
+// Same layout as nx's mii::CharInfo, kept as raw data since it's only stored here
+pub const MII_CHARINFO_SIZE: usize = 0x58;
+pub type MiiCharInfoData = [u8; MII_CHARINFO_SIZE];
+
+// A virtual amiibo created from a deprecated one (see compat.rs)
+#[derive(Clone, Debug)]
+pub struct ConvertedVirtualAmiibo {
+    pub info: VirtualAmiiboInfo,
+    // None if the platform couldn't generate one (see Platform::generate_random_mii)
+    pub mii_charinfo: Option<MiiCharInfoData>,
+    pub areas: VirtualAmiiboAreaInfo,
+    pub path: String
+}
+
+impl ConvertedVirtualAmiibo {
+    #[inline]
+    pub fn ensure_area_registered(&mut self, access_id: u32, program_id: u64) {
+        self.areas.register_area(access_id, program_id);
+    }
+
+    pub fn save_area<P: Platform>(&self, platform: &P, access_id: u32, data: &[u8]) -> crate::Result<P, ()> {
+        let areas_dir = format!("{}/areas", self.path);
+        let _ = platform.create_directory(areas_dir.as_str());
+        platform.write_file(format!("{}/0x{:08X}.bin", areas_dir, access_id).as_str(), data)
+    }
+
+    pub fn save<P: Platform>(&self, platform: &P) -> crate::Result<P, ()> {
+        save_info(platform, self.path.as_str(), &self.info)?;
+        if let Some(mii_charinfo) = self.mii_charinfo.as_ref() {
+            let mii_charinfo_path = format!("{}/{}", self.path, self.info.mii_charinfo_file);
+            platform.write_file(mii_charinfo_path.as_str(), mii_charinfo)?;
+        }
+        save_areas(platform, self.path.as_str(), &self.areas)
+    }
+}
+
+pub fn save_info<P: Platform>(platform: &P, path: &str, info: &VirtualAmiiboInfo) -> crate::Result<P, ()> {
+    let amiibo_json_path = format!("{}/amiibo.json", path);
+    util::write_serialize_json(platform, amiibo_json_path.as_str(), info)?;
+
+    let amiibo_flag_path = format!("{}/amiibo.flag", path);
+    let _ = platform.create_file(amiibo_flag_path.as_str());
+    Ok(())
+}
+
+pub fn save_areas<P: Platform>(platform: &P, path: &str, areas: &VirtualAmiiboAreaInfo) -> crate::Result<P, ()> {
+    let areas_json_path = format!("{}/areas.json", path);
+    util::write_serialize_json(platform, areas_json_path.as_str(), areas)
+}
+
+pub fn generate_areas_json<P: Platform>(platform: &P, path: &str) -> crate::Result<P, Option<u32>> {
+    let mut access_ids: Vec<u32> = Vec::new();
+
+    let areas_dir = format!("{}/areas", path);
+    if let Ok(names) = platform.list_files(areas_dir.as_str()) {
+        for name in names.iter() {
+            // 0x<hex-access-id>.bin
+            if name.ends_with(".bin") && name.starts_with("0x") && (name.len() == 2 + 8 + 4) {
+                let hex_access_id_str = &name[2..2 + 8];
+                if let Ok(access_id) = u32::from_str_radix(hex_access_id_str, 16) {
+                    access_ids.push(access_id);
+                }
+            }
+        }
+    }
+
+    let mut areas = VirtualAmiiboAreaInfo::empty();
+    for access_id in &access_ids {
+        let area_entry = VirtualAmiiboAreaEntry {
+            program_id: DEFAULT_EMPTY_AREA_PROGRAM_ID,
+            access_id: *access_id
+        };
+        areas.areas.push(area_entry);
+    }
+    let access_id = access_ids.get(0).map(|id_ref| *id_ref);
+    if let Some(id) = access_id {
+        areas.current_area_access_id = id;
+    }
+
+    save_areas(platform, path, &areas)?;
+    Ok(access_id)
+}
+
+#[inline]
+pub fn is_virtual_amiibo<P: Platform>(platform: &P, path: &str) -> bool {
+    platform.is_file(format!("{}/amiibo.flag", path).as_str())
+}
+
+pub struct LoadedVirtualAmiibo {
+    pub info: VirtualAmiiboInfo,
+    pub areas: VirtualAmiiboAreaInfo,
+    // Some fixes were applied while loading, which should be saved
+    pub needs_save: bool
+}
+
+// Loads amiibo.json/areas.json as emuiibo does (generating areas.json if missing), after checking the amiibo flag with is_virtual_amiibo
+pub fn load_json<P: Platform>(platform: &P, path: &str) -> crate::Result<P, LoadedVirtualAmiibo> {
+    let amiibo_json_path = format!("{}/amiibo.json", path);
+    result_return_unless!(platform.is_file(amiibo_json_path.as_str()), P, VirtualAmiiboJsonNotFound);
+
+    let areas_json_path = format!("{}/areas.json", path);
+    if !platform.is_file(areas_json_path.as_str()) {
+        generate_areas_json(platform, path)?;
+    }
+    result_return_unless!(platform.is_file(areas_json_path.as_str()), P, VirtualAmiiboAreasJsonNotFound);
+
+    let mut needs_save = false;
+
+    let mut amiibo_json_opt: VirtualAmiiboInfoOptional = util::read_deserialize_json(platform, amiibo_json_path.as_str())?;
+    // Fix for those which lack uuids
+    if amiibo_json_opt.uuid.is_none() {
+        let mut uuid = [0u8; 10];
+        crate::generate_random_uuid(platform, &mut uuid)?;
+        amiibo_json_opt.uuid = Some(uuid.to_vec());
+        amiibo_json_opt.use_random_uuid = Some(true);
+        needs_save = true;
+    }
+    if amiibo_json_opt.use_random_uuid.is_none() {
+        amiibo_json_opt.use_random_uuid = Some(false);
+        needs_save = true;
+    }
+
+    let areas: VirtualAmiiboAreaInfo = util::read_deserialize_json(platform, areas_json_path.as_str())?;
+    Ok(LoadedVirtualAmiibo { info: amiibo_json_opt.convert_to_info(), areas, needs_save })
+}
+
+pub fn load<P: Platform>(platform: &P, path: &str) -> crate::Result<P, LoadedVirtualAmiibo> {
+    result_return_unless!(is_virtual_amiibo(platform, path), P, VirtualAmiiboFlagNotFound);
+    load_json(platform, path)
+}
@@ -0,0 +1,44 @@
+#![no_std]
+
+// Virtual amiibo formats (current and deprecated ones, raw dumps) and their conversions, shared by emuiibo and its PC tools
+// Only needs core and alloc: file access, randomness and errors are provided by the user through the Platform trait
+
+#[macro_use]
+extern crate static_assertions;
+
+#[macro_use]
+extern crate alloc;
+
+#[macro_use]
+pub mod util;
+
+#[macro_use]
+pub mod platform;
+
+pub mod compat;
+
+pub mod ntag;
+
+pub mod bin;
+
+pub mod v1;
+
+pub mod v2;
+
+pub mod v3;
+
+pub mod fmt;
+
+pub mod meta;
+
+pub use platform::{ErrorKind, Platform, Result};
+
+pub const APP_AREA_SIZE: usize = 0xD8;
+
+pub fn generate_random_uuid<P: Platform>(platform: &P, uuid: &mut [u8;10]) -> Result<P, ()> {
+    platform.fill_random(&mut uuid[..7])?;
+    uuid[7] = 0;
+    uuid[8] = 0;
+    uuid[9] = 0;
+    Ok(())
+}
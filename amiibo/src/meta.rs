@@ -0,0 +1,199 @@
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::platform::{Platform, Result};
+use crate::util;
+use super::bin::Buffer;
+use super::fmt::{VirtualAmiiboAreaEntry, VirtualAmiiboAreaInfo, VirtualAmiiboDate, VirtualAmiiboId, VirtualAmiiboInfo};
+
+/*
+Optional packed binary sidecar (amiibo-meta.bin) holding everything a game write changes, so it can be saved with a single small write:
+
+- Fixed-size header (MetaHeader): IDs, dates, counters, UUID, current area, name and Mii charinfo file name
+- Area table: MetaAreaEntry[area_capacity] (only the first area_count ones are valid)
+
+The area capacity only grows (in steps of AREA_CAPACITY_STEP), so the file is always rewritten in place without truncating it.
+amiibo.json/areas.json are still the import/export format: the sidecar gets created from them when missing, and they get exported back when the amiibo stops being used.
+The header keeps a hash of the JSONs it was last in sync with, so JSONs changed without it (edited on a PC, saved while the sidecar was disabled...) get imported again instead of being ignored.
+
+Note that the name differs from "amiibo.bin", which was the raw dump in the old v2 format.
+*/
+
+pub const META_FILE_NAME: &'static str = "amiibo-meta.bin";
+pub const META_MAGIC: u32 = u32::from_le_bytes(*b"EMTA");
+pub const META_VERSION: u16 = 2;
+
+const AREA_CAPACITY_STEP: usize = 8;
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct MetaDate {
+    pub year: u16,
+    pub month: u8,
+    pub day: u8
+}
+
+impl MetaDate {
+    pub const fn from(date: &VirtualAmiiboDate) -> Self {
+        Self { year: date.y, month: date.m, day: date.d }
+    }
+
+    pub const fn to_date(&self) -> VirtualAmiiboDate {
+        VirtualAmiiboDate { y: self.year, m: self.month, d: self.day }
+    }
+}
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct MetaHeader {
+    pub magic: u32,
+    pub version: u16,
+    pub area_count: u16,
+    pub area_capacity: u16,
+    pub write_counter: u16,
+    pub game_character_id: u16,
+    pub character_variant: u8,
+    pub figure_type: u8,
+    pub model_number: u16,
+    pub series: u8,
+    pub format_version: u8,
+    pub use_random_uuid: u8,
+    pub uuid: [u8; 10],
+    pub reserved_1: u8,
+    pub first_write_date: MetaDate,
+    pub last_write_date: MetaDate,
+    pub current_area_access_id: u32,
+    pub name: util::ArrayString<0x30>,
+    pub mii_charinfo_file: util::ArrayString<0x40>,
+    pub reserved_2: [u8; 0x4],
+    pub json_hash: u64
+}
+const_assert!(core::mem::size_of::<MetaHeader>() == 0xA8);
+
+impl Buffer for MetaHeader {}
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct MetaAreaEntry {
+    pub program_id: u64,
+    pub access_id: u32,
+    pub reserved: u32
+}
+const_assert!(core::mem::size_of::<MetaAreaEntry>() == 0x10);
+
+impl Buffer for MetaAreaEntry {}
+
+#[inline]
+pub fn make_meta_path(amiibo_path: &str) -> String {
+    format!("{}/{}", amiibo_path, META_FILE_NAME)
+}
+
+pub struct LoadedMeta {
+    pub info: VirtualAmiiboInfo,
+    pub areas: VirtualAmiiboAreaInfo,
+    // The sidecar's current area capacity, to be kept on later writes
+    pub area_capacity: usize,
+    // Hash of the JSONs the sidecar was last in sync with (see hash_json_files)
+    pub json_hash: u64
+}
+
+// FNV-1a of amiibo.json and areas.json's contents (missing ones count as empty)
+pub fn hash_json_files<P: Platform>(platform: &P, amiibo_path: &str) -> u64 {
+    let mut hash: u64 = 0xCBF29CE484222325;
+    for json_name in ["amiibo.json", "areas.json"] {
+        if let Ok(data) = platform.read_file(format!("{}/{}", amiibo_path, json_name).as_str()) {
+            for byte in data.iter() {
+                hash ^= *byte as u64;
+                hash = hash.wrapping_mul(0x100000001B3);
+            }
+        }
+    }
+    hash
+}
+
+pub fn read<P: Platform>(platform: &P, amiibo_path: &str) -> Result<P, LoadedMeta> {
+    // Single read of the whole file
+    let data = platform.read_file(make_meta_path(amiibo_path).as_str())?;
+
+    let header_size = core::mem::size_of::<MetaHeader>();
+    result_return_unless!(data.len() >= header_size, P, InvalidVirtualAmiiboMeta);
+    let mut header: MetaHeader = Default::default();
+    header.get_buf_mut().copy_from_slice(&data[..header_size]);
+    result_return_unless!(header.magic == META_MAGIC, P, InvalidVirtualAmiiboMeta);
+    result_return_unless!(header.version == META_VERSION, P, InvalidVirtualAmiiboMeta);
+    result_return_unless!(header.area_count <= header.area_capacity, P, InvalidVirtualAmiiboMeta);
+
+    let area_entry_size = core::mem::size_of::<MetaAreaEntry>();
+    result_return_unless!(data.len() >= header_size + header.area_capacity as usize * area_entry_size, P, InvalidVirtualAmiiboMeta);
+
+    let mut areas = VirtualAmiiboAreaInfo::empty();
+    for i in 0..header.area_count as usize {
+        let offset = header_size + i * area_entry_size;
+        let mut entry: MetaAreaEntry = Default::default();
+        entry.get_buf_mut().copy_from_slice(&data[offset..offset + area_entry_size]);
+        areas.areas.push(VirtualAmiiboAreaEntry { program_id: entry.program_id, access_id: entry.access_id });
+    }
+    areas.current_area_access_id = header.current_area_access_id;
+
+    let info = VirtualAmiiboInfo {
+        first_write_date: header.first_write_date.to_date(),
+        id: VirtualAmiiboId {
+            game_character_id: header.game_character_id,
+            character_variant: header.character_variant,
+            figure_type: header.figure_type,
+            model_number: header.model_number,
+            series: header.series
+        },
+        last_write_date: header.last_write_date.to_date(),
+        mii_charinfo_file: header.mii_charinfo_file.get_string(),
+        name: header.name.get_string(),
+        uuid: header.uuid.to_vec(),
+        use_random_uuid: header.use_random_uuid != 0,
+        version: header.format_version,
+        write_counter: header.write_counter
+    };
+    Ok(LoadedMeta { info, areas, area_capacity: header.area_capacity as usize, json_hash: header.json_hash })
+}
+
+pub fn write<P: Platform>(platform: &P, amiibo_path: &str, info: &VirtualAmiiboInfo, areas: &VirtualAmiiboAreaInfo, json_hash: u64, area_capacity: &mut usize) -> Result<P, ()> {
+    if areas.areas.len() > *area_capacity {
+        *area_capacity = areas.areas.len().next_multiple_of(AREA_CAPACITY_STEP);
+    }
+    result_return_unless!(*area_capacity <= u16::MAX as usize, P, InvalidVirtualAmiiboMeta);
+
+    let mut header = MetaHeader {
+        magic: META_MAGIC,
+        version: META_VERSION,
+        area_count: areas.areas.len() as u16,
+        area_capacity: *area_capacity as u16,
+        write_counter: info.write_counter,
+        game_character_id: info.id.game_character_id,
+        character_variant: info.id.character_variant,
+        figure_type: info.id.figure_type,
+        model_number: info.id.model_number,
+        series: info.id.series,
+        format_version: info.version,
+        use_random_uuid: info.use_random_uuid as u8,
+        first_write_date: MetaDate::from(&info.first_write_date),
+        last_write_date: MetaDate::from(&info.last_write_date),
+        current_area_access_id: areas.current_area_access_id,
+        json_hash,
+        ..Default::default()
+    };
+    let uuid_len = header.uuid.len().min(info.uuid.len());
+    header.uuid[..uuid_len].copy_from_slice(&info.uuid[..uuid_len]);
+    header.name.set_str(info.name.as_str());
+    header.mii_charinfo_file.set_str(info.mii_charinfo_file.as_str());
+
+    let mut data: Vec<u8> = Vec::with_capacity(core::mem::size_of::<MetaHeader>() + *area_capacity * core::mem::size_of::<MetaAreaEntry>());
+    data.extend_from_slice(header.get_buf());
+    for i in 0..*area_capacity {
+        let entry = match areas.areas.get(i) {
+            Some(area) => MetaAreaEntry { program_id: area.program_id, access_id: area.access_id, reserved: 0 },
+            None => Default::default()
+        };
+        data.extend_from_slice(entry.get_buf());
+    }
+
+    // Overwritten in place: the file never shrinks (see above), so no need to delete/truncate it first
+    platform.overwrite_file(make_meta_path(amiibo_path).as_str(), &data)
+}
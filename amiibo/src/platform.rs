@@ -0,0 +1,63 @@
+use alloc::string::String;
+use alloc::vec::Vec;
+use crate::fmt::MiiCharInfoData;
+
+// Errors detected by the formats themselves, turned into the platform's own error type (emuiibo maps them to its result codes)
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+pub enum ErrorKind {
+    InvalidSize,
+    InvalidJsonSerialization,
+    InvalidJsonDeserialization,
+    VirtualAmiiboFlagNotFound,
+    VirtualAmiiboJsonNotFound,
+    VirtualAmiiboAreasJsonNotFound,
+    InvalidLoadedVirtualAmiibo,
+    InvalidVirtualAmiiboMeta
+}
+
+pub trait Platform: Sized {
+    type Error: core::fmt::Debug;
+
+    fn make_error(kind: ErrorKind) -> Self::Error;
+
+    fn read_file(&self, path: &str) -> Result<Self, Vec<u8>>;
+
+    // Replaces the file if it already exists
+    fn write_file(&self, path: &str, data: &[u8]) -> Result<Self, ()>;
+
+    // Writes from the start of the file (creating it if needed) without truncating it first
+    fn overwrite_file(&self, path: &str, data: &[u8]) -> Result<Self, ()>;
+
+    // Creates an empty file, fails if it already exists
+    fn create_file(&self, path: &str) -> Result<Self, ()>;
+
+    fn exists(&self, path: &str) -> bool;
+
+    fn is_file(&self, path: &str) -> bool;
+
+    fn create_directory(&self, path: &str) -> Result<Self, ()>;
+
+    // Names of the files (not directories) inside a directory, in no particular order
+    fn list_files(&self, path: &str) -> Result<Self, Vec<String>>;
+
+    fn rename_file(&self, old_path: &str, new_path: &str) -> Result<Self, ()>;
+
+    fn rename_directory(&self, old_path: &str, new_path: &str) -> Result<Self, ()>;
+
+    fn remove_dir_all(&self, path: &str) -> Result<Self, ()>;
+
+    fn fill_random(&self, buf: &mut [u8]) -> Result<Self, ()>;
+
+    // None if the platform can't generate miis, emuiibo will then generate one when the virtual amiibo gets loaded
+    fn generate_random_mii(&self) -> Result<Self, Option<MiiCharInfoData>>;
+}
+
+pub type Result<P, T> = core::result::Result<T, <P as Platform>::Error>;
+
+macro_rules! result_return_unless {
+    ($cond:expr, $platform:ty, $kind:ident) => {
+        if !$cond {
+            return Err(<$platform as $crate::platform::Platform>::make_error($crate::platform::ErrorKind::$kind));
+        }
+    };
+}
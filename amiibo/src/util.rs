@@ -0,0 +1,178 @@
+use alloc::string::{String, ToString};
+use serde::{Serialize, de::DeserializeOwned};
+use crate::platform::{ErrorKind, Platform, Result};
+
+// Same bit helpers as nx's, which the formats were written with
+
+macro_rules! bit {
+    ($val:expr) => {
+        (1 << $val)
+    };
+}
+
+macro_rules! read_bits {
+    ($start:expr, $end:expr, $value:expr) => {
+        ($value & (((1 << ($end - $start + 1)) - 1) << $start)) >> $start
+    };
+}
+
+macro_rules! write_bits {
+    ($start:expr, $end:expr, $value:expr, $data:expr) => {
+        $value = ($value & (!(((1 << ($end - $start + 1)) - 1) << $start))) | ($data << $start)
+    };
+}
+
+macro_rules! define_bit_enum {
+    ($name:ident ($base:ty) { $( $entry:ident = $value:expr ),* }) => {
+        #[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+        #[repr(transparent)]
+        pub struct $name($base);
+
+        #[allow(non_snake_case)]
+        impl $name {
+            pub const fn from(val: $base) -> Self {
+                Self(val)
+            }
+
+            pub const fn get(&self) -> $base {
+                self.0
+            }
+
+            pub const fn contains(&self, other: Self) -> bool {
+                (self.0 & other.0) == other.0
+            }
+
+            $(
+                pub const fn $entry() -> Self {
+                    Self($value)
+                }
+            )*
+        }
+
+        impl core::ops::BitOr for $name {
+            type Output = Self;
+
+            fn bitor(self, other: Self) -> Self {
+                Self(self.0 | other.0)
+            }
+        }
+    };
+}
+
+// NUL-terminated UTF-8 string, laid out like nx's util::ArrayString
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+#[repr(C)]
+pub struct ArrayString<const S: usize> {
+    c_str: [u8; S]
+}
+
+impl<const S: usize> Default for ArrayString<S> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<const S: usize> ArrayString<S> {
+    pub const fn new() -> Self {
+        Self { c_str: [0; S] }
+    }
+
+    pub fn from_str(string: &str) -> Self {
+        let mut array_str = Self::new();
+        array_str.set_str(string);
+        array_str
+    }
+
+    // Truncated (at a character boundary) if too long, always keeping the NUL terminator
+    pub fn set_str(&mut self, string: &str) {
+        let mut len = string.len().min(S - 1);
+        while !string.is_char_boundary(len) {
+            len -= 1;
+        }
+
+        self.c_str = [0; S];
+        self.c_str[..len].copy_from_slice(&string.as_bytes()[..len]);
+    }
+
+    pub fn get_string(&self) -> String {
+        let len = self.c_str.iter().position(|&c| c == 0).unwrap_or(S);
+        String::from_utf8_lossy(&self.c_str[..len]).to_string()
+    }
+
+    #[inline]
+    pub const fn as_bytes(&self) -> &[u8] {
+        &self.c_str
+    }
+}
+
+// NUL-terminated UTF-16 string, laid out like nx's util::ArrayWideString
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+#[repr(C)]
+pub struct ArrayWideString<const S: usize> {
+    c_wstr: [u16; S]
+}
+
+impl<const S: usize> Default for ArrayWideString<S> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<const S: usize> ArrayWideString<S> {
+    pub const fn new() -> Self {
+        Self { c_wstr: [0; S] }
+    }
+
+    pub fn from_string(string: String) -> Self {
+        let mut array_wstr = Self::new();
+        array_wstr.set_string(string);
+        array_wstr
+    }
+
+    // Truncated if too long, always keeping the NUL terminator
+    pub fn set_string(&mut self, string: String) {
+        self.c_wstr = [0; S];
+        for (c, wc) in self.c_wstr[..S - 1].iter_mut().zip(string.encode_utf16()) {
+            *c = wc;
+        }
+    }
+
+    pub fn get_string(&self) -> String {
+        let len = self.c_wstr.iter().position(|&c| c == 0).unwrap_or(S);
+        String::from_utf16_lossy(&self.c_wstr[..len])
+    }
+
+    #[inline]
+    pub const fn as_u16_str(&self) -> &[u16] {
+        &self.c_wstr
+    }
+}
+
+pub fn get_path_without_extension(path: impl AsRef<str>) -> String {
+    let path = path.as_ref();
+    match path.rfind('.') {
+        Some(offset) => {
+            path[..offset].to_string()
+        },
+        None => path.to_string()
+    }
+}
+
+pub fn get_path_file_name(path: impl AsRef<str>) -> String {
+    path.as_ref().split('/').last().unwrap_or("").to_string()
+}
+
+#[inline]
+pub fn get_path_file_name_without_extension(path: String) -> String {
+    get_path_file_name(get_path_without_extension(path))
+}
+
+pub fn read_deserialize_json<P: Platform, T: DeserializeOwned>(platform: &P, path: &str) -> Result<P, T> {
+    let json_data = platform.read_file(path)?;
+    serde_json::from_slice::<T>(&json_data).map_err(|_| P::make_error(ErrorKind::InvalidJsonDeserialization))
+}
+
+pub fn write_serialize_json<P: Platform, T: Serialize>(platform: &P, path: &str, t: &T) -> Result<P, ()> {
+    let json_data = serde_json::to_vec_pretty(t).map_err(|_| P::make_error(ErrorKind::InvalidJsonSerialization))?;
+    platform.write_file(path, &json_data)
+}
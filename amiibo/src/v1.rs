@@ -0,0 +1,87 @@
+use alloc::string::{String, ToString};
+use crate::platform::{Platform, Result};
+use crate::util;
+use super::bin::{self, Buffer};
+use super::{compat, fmt};
+
+// Virtual amiibo format used in emuiibo v0.1
+// It's not an actual virtual amiibo format, raw bin dumps were directly read/used
+
+// Always present in actual dumps, anything else is just a random .bin file
+pub const RAW_FORMAT_MAGIC: u8 = 0xA5;
+
+#[derive(Debug)]
+pub struct VirtualAmiibo {
+    raw_bin_path: String,
+    raw_bin: bin::RawFormat
+}
+
+impl VirtualAmiibo {
+    #[inline]
+    pub fn get_raw_bin(&self) -> &bin::RawFormat {
+        &self.raw_bin
+    }
+}
+
+impl compat::DeprecatedVirtualAmiiboFormat for VirtualAmiibo {
+    fn try_load<P: Platform>(platform: &P, path: String) -> Result<P, Self> {
+        let raw_bin_data = platform.read_file(path.as_str())?;
+        let mut raw_bin: bin::RawFormat = Default::default();
+        let raw_bin_buf = raw_bin.get_buf_mut();
+        result_return_unless!(raw_bin_data.len() >= raw_bin_buf.len(), P, InvalidSize);
+        raw_bin_buf.copy_from_slice(&raw_bin_data[..raw_bin_buf.len()]);
+        result_return_unless!(raw_bin.st_2.unk_0xa5 == RAW_FORMAT_MAGIC, P, InvalidLoadedVirtualAmiibo);
+
+        Ok(Self { raw_bin_path: path, raw_bin })
+    }
+
+    fn get_path(&self) -> &str {
+        self.raw_bin_path.as_str()
+    }
+
+    fn get_convert_name(&self) -> String {
+        util::get_path_file_name_without_extension(self.raw_bin_path.clone())
+    }
+
+    fn convert_to<P: Platform>(&self, platform: &P, key_set: Option<&bin::RetailKeySetContext>, path: String) -> Result<P, fmt::ConvertedVirtualAmiibo> {
+        // Convert (and decrypt if possible) raw format
+        let conv_bin = bin::ConvertedFormat::from_raw(&self.raw_bin);
+
+        let plain_bin = match key_set {
+            Some(key_set_v) => bin::PlainFormat::decrypt_from_converted(&conv_bin, key_set_v).map_err(P::make_error)?,
+            None => bin::PlainFormat::from_converted(&conv_bin)
+        };
+
+        // Save converted amiibo
+        platform.create_directory(path.as_str())?;
+
+        let mii_charinfo_name = "mii-charinfo.bin".to_string();
+        let mut amiibo = plain_bin.to_virtual_amiibo(platform, path.clone(), mii_charinfo_name)?;
+
+        // Save application area if present
+        if plain_bin.dec_data.settings.flags.contains(bin::Flags::ApplicationAreaUsed()) {
+            let access_id = plain_bin.dec_data.settings.access_id_be.swap_bytes();
+            let program_id = plain_bin.dec_data.settings.program_id_be.swap_bytes();
+            amiibo.save_area(platform, access_id, &plain_bin.dec_data.app_area)?;
+
+            amiibo.ensure_area_registered(access_id, program_id);
+        }
+
+        amiibo.save(platform)?;
+
+        // Save deprecated amiibo inside /v1 dir
+        let deprecated_path = format!("{}/v1", path);
+        platform.create_directory(deprecated_path.as_str())?;
+
+        let new_raw_bin_path = format!("{}/raw-format.bin", deprecated_path);
+        platform.rename_file(self.raw_bin_path.as_str(), new_raw_bin_path.as_str())?;
+
+        let conv_bin_path = format!("{}/converted-format.bin", deprecated_path);
+        platform.write_file(conv_bin_path.as_str(), conv_bin.get_buf())?;
+
+        let plain_bin_path = format!("{}/plain-format.bin", deprecated_path);
+        platform.write_file(plain_bin_path.as_str(), plain_bin.get_buf())?;
+
+        Ok(amiibo)
+    }
+}
@@ -0,0 +1,179 @@
+use alloc::{string::{String, ToString}, vec::Vec};
+use serde::{Serialize, Deserialize};
+use crate::platform::{Platform, Result};
+use crate::util;
+use super::bin::{self, Buffer};
+use super::{compat, fmt};
+
+// Virtual amiibo format used in emuiibo v0.2 and v0.2.1
+// Consists on the following:
+/*
+- mii.dat file (with mii charinfo, generated on first boot)
+- amiibo.bin raw dump (amiibo id, uuid, etc. were grabbed from here when needed)
+- amiibo.json --> example:
+{
+    "name": "MyCoolAmiibo",
+    "firstWriteDate": [ 2020, 12, 12 ],
+    "lastWriteDate": [ 2020, 12, 12 ],
+    "applicationAreaSize": 216,
+    "randomizeUuid": true
+}
+*/
+
+#[derive(Serialize, Deserialize, Clone, Debug)]
+#[allow(non_snake_case)]
+pub struct VirtualAmiiboInfo {
+    name: String,
+    firstWriteDate: Vec<u32>,
+    lastWriteDate: Vec<u32>,
+    applicationAreaSize: u32,
+    randomizeUuid: bool
+}
+
+fn convert_date(json_date: &Vec<u32>) -> Option<fmt::VirtualAmiiboDate> {
+    Some(fmt::VirtualAmiiboDate {
+        y: *json_date.get(0)? as u16,
+        m: *json_date.get(1)? as u8,
+        d: *json_date.get(2)? as u8
+    })
+}
+
+#[derive(Clone, Debug)]
+pub struct VirtualAmiibo {
+    path: String,
+    info: VirtualAmiiboInfo,
+    // None if it didn't exist and the platform can't generate miis
+    mii_charinfo: Option<fmt::MiiCharInfoData>,
+    raw_bin: bin::RawFormat
+}
+
+impl compat::DeprecatedVirtualAmiiboFormat for VirtualAmiibo {
+    fn try_load<P: Platform>(platform: &P, path: String) -> Result<P, Self> {
+        let raw_bin: bin::RawFormat = {
+            let raw_bin_path = format!("{}/amiibo.bin", path);
+            let raw_bin_data = platform.read_file(raw_bin_path.as_str())?;
+            let mut raw_bin: bin::RawFormat = Default::default();
+            let raw_bin_buf = raw_bin.get_buf_mut();
+            result_return_unless!(raw_bin_data.len() >= raw_bin_buf.len(), P, InvalidSize);
+            raw_bin_buf.copy_from_slice(&raw_bin_data[..raw_bin_buf.len()]);
+            raw_bin
+        };
+
+        let amiibo_json_path = format!("{}/amiibo.json", path);
+        let amiibo_json: VirtualAmiiboInfo = util::read_deserialize_json(platform, amiibo_json_path.as_str())?;
+        result_return_unless!(amiibo_json.firstWriteDate.len() >= 3, P, InvalidLoadedVirtualAmiibo);
+        result_return_unless!(amiibo_json.lastWriteDate.len() >= 3, P, InvalidLoadedVirtualAmiibo);
+
+        let mii_charinfo_path = format!("{}/mii.dat", path);
+        // If newly generated, charinfo may not exist yet
+        let mii_charinfo = match platform.exists(mii_charinfo_path.as_str()) {
+            false => {
+                let mii_charinfo = platform.generate_random_mii()?;
+                if let Some(mii_charinfo_data) = mii_charinfo.as_ref() {
+                    platform.write_file(mii_charinfo_path.as_str(), mii_charinfo_data)?;
+                }
+                mii_charinfo
+            },
+            true => {
+                let mii_charinfo_data = platform.read_file(mii_charinfo_path.as_str())?;
+                let mii_charinfo_data = mii_charinfo_data.get(..fmt::MII_CHARINFO_SIZE).and_then(|data| fmt::MiiCharInfoData::try_from(data).ok());
+                result_return_unless!(mii_charinfo_data.is_some(), P, InvalidSize);
+                mii_charinfo_data
+            }
+        };
+        Ok(Self { path, info: amiibo_json, mii_charinfo, raw_bin })
+    }
+
+    fn get_path(&self) -> &str {
+        self.path.as_str()
+    }
+
+    fn get_convert_name(&self) -> String {
+        util::get_path_file_name(self.path.as_str())
+    }
+
+    fn convert_to<P: Platform>(&self, platform: &P, key_set: Option<&bin::RetailKeySetContext>, path: String) -> Result<P, fmt::ConvertedVirtualAmiibo> {
+        // Convert (and decrypt if possible) raw format
+        let conv_bin = bin::ConvertedFormat::from_raw(&self.raw_bin);
+
+        let plain_bin = match key_set {
+            Some(key_set_v) => bin::PlainFormat::decrypt_from_converted(&conv_bin, key_set_v).map_err(P::make_error)?,
+            None => bin::PlainFormat::from_converted(&conv_bin)
+        };
+
+        // Save converted amiibo
+        let _ = platform.create_directory(path.as_str());
+
+        let old_areas_path = format!("{}/areas", self.path);
+        let new_areas_path = format!("{}/areas", path);
+        let _ = platform.rename_directory(old_areas_path.as_str(), new_areas_path.as_str())?;
+
+        let mii_charinfo_name = "mii-charinfo.bin".to_string();
+        let mut amiibo = plain_bin.to_virtual_amiibo(platform, path.clone(), mii_charinfo_name)?;
+
+        // Prefer existing mii/app-area over raw bin mii/app-area
+        if self.mii_charinfo.is_some() {
+            amiibo.mii_charinfo = self.mii_charinfo;
+        }
+        amiibo.info.name = self.info.name.clone();
+        amiibo.info.use_random_uuid = self.info.randomizeUuid;
+        amiibo.info.uuid = {
+            let mut uuid = [0u8;10];
+            crate::generate_random_uuid(platform, &mut uuid)?;
+            uuid.to_vec()
+        };
+        // Both checked when loading
+        amiibo.info.first_write_date = convert_date(&self.info.firstWriteDate).unwrap();
+        amiibo.info.last_write_date = convert_date(&self.info.lastWriteDate).unwrap();
+
+        let existing_access_id = fmt::generate_areas_json(platform, path.as_str())?;
+        if let Some(existing_id) = existing_access_id {
+            amiibo.ensure_area_registered(existing_id, fmt::DEFAULT_EMPTY_AREA_PROGRAM_ID);
+        }
+
+        // Save application area if present
+        if plain_bin.dec_data.settings.flags.contains(bin::Flags::ApplicationAreaUsed()) {
+            let access_id = plain_bin.dec_data.settings.access_id_be.swap_bytes();
+            let program_id = plain_bin.dec_data.settings.program_id_be.swap_bytes();
+            let existing_id = existing_access_id.unwrap_or(0);
+
+            if existing_access_id.is_none() || (existing_id != access_id) {
+                amiibo.save_area(platform, access_id, &plain_bin.dec_data.app_area)?;
+
+                amiibo.ensure_area_registered(access_id, program_id);
+            }
+        }
+
+        amiibo.save(platform)?;
+
+        // Save deprecated amiibo inside /v2 dir
+        let deprecated_path = format!("{}/v2", path);
+        platform.create_directory(deprecated_path.as_str())?;
+
+        let old_raw_bin_path = format!("{}/amiibo.bin", self.path);
+        let new_raw_bin_path = format!("{}/amiibo.bin", deprecated_path);
+        platform.rename_file(old_raw_bin_path.as_str(), new_raw_bin_path.as_str())?;
+
+        let conv_bin_path = format!("{}/amiibo-converted.bin", deprecated_path);
+        platform.write_file(conv_bin_path.as_str(), conv_bin.get_buf())?;
+
+        let plain_bin_path = format!("{}/amiibo-plain.bin", deprecated_path);
+        platform.write_file(plain_bin_path.as_str(), plain_bin.get_buf())?;
+
+        if self.mii_charinfo.is_some() {
+            let old_mii_charinfo_path = format!("{}/mii.dat", self.path);
+            let new_mii_charinfo_path = format!("{}/mii.dat", deprecated_path);
+            platform.rename_file(old_mii_charinfo_path.as_str(), new_mii_charinfo_path.as_str())?;
+        }
+
+        let old_amiibo_json_path = format!("{}/amiibo.json", self.path);
+        let new_amiibo_json_path = format!("{}/amiibo.json", deprecated_path);
+        platform.rename_file(old_amiibo_json_path.as_str(), new_amiibo_json_path.as_str())?;
+
+        if self.path != path {
+            platform.remove_dir_all(self.path.as_str())?;
+        }
+
+        Ok(amiibo)
+    }
+}
@@ -1,10 +1,11 @@
-use super::{bin, compat, fmt};
-use crate::{fsext, miiext};
+use super::bin;
+use super::{compat, fmt};
+use crate::platform::{ErrorKind, Platform, Result};
+use crate::util;
 use alloc::{
     string::{String, ToString},
     vec::Vec,
 };
-use nx::{fs, result::*, service::mii};
 use serde::{Deserialize, Serialize};
 
 // Virtual amiibo format used in emuiibo v0.3, v0.3.1 and v0.4
@@ -69,50 +70,62 @@ pub struct VirtualAmiiboRegisterInfo {
 }
 
 // Why did I use this format back then... it's quite annoying to parse
+// Note: malformed values make the conversion fail, instead of panicking
 
-fn convert_date(info_date: &String) -> fmt::VirtualAmiiboDate {
-    let y_str = &info_date[0..4];
-    let y = u16::from_str_radix(y_str, 10).unwrap();
+fn convert_date(info_date: &String) -> Option<fmt::VirtualAmiiboDate> {
+    let y_str = info_date.get(0..4)?;
+    let y = u16::from_str_radix(y_str, 10).ok()?;
 
-    let m_str = &info_date[5..7];
-    let m = u8::from_str_radix(m_str, 10).unwrap();
+    let m_str = info_date.get(5..7)?;
+    let m = u8::from_str_radix(m_str, 10).ok()?;
 
-    let d_str = &info_date[8..10];
-    let d = u8::from_str_radix(d_str, 10).unwrap();
+    let d_str = info_date.get(8..10)?;
+    let d = u8::from_str_radix(d_str, 10).ok()?;
 
-    fmt::VirtualAmiiboDate { y, m, d }
+    Some(fmt::VirtualAmiiboDate { y, m, d })
 }
 
 #[inline]
-fn convert_from_hex(hex: String) -> Vec<u8> {
+fn convert_from_hex(hex: String) -> Option<Vec<u8>> {
     (0..hex.len())
         .step_by(2)
-        .map(|i| u8::from_str_radix(&hex[i..i + 2], 16))
-        .collect::<core::result::Result<Vec<u8>, _>>()
-        .unwrap()
+        .map(|i| hex.get(i..i + 2).and_then(|byte_hex| u8::from_str_radix(byte_hex, 16).ok()))
+        .collect::<Option<Vec<u8>>>()
 }
 
 #[inline]
-fn get_raw_hex_bytes<const S: usize>(hex: String) -> [u8; S] {
+fn get_raw_hex_bytes<const S: usize>(hex: String) -> Option<[u8; S]> {
     let mut raw: [u8; S] = [0; S];
-    let bytes = convert_from_hex(hex);
+    let bytes = convert_from_hex(hex)?;
 
     for i in 0..S {
-        raw[i] = bytes[i];
+        raw[i] = *bytes.get(i)?;
     }
 
-    raw
+    Some(raw)
 }
 
-fn convert_amiibo_id(info_id: String) -> fmt::VirtualAmiiboId {
-    let raw_id = get_raw_hex_bytes::<8>(info_id);
-    unsafe { core::mem::transmute(raw_id) }
+fn convert_amiibo_id(info_id: String) -> Option<fmt::VirtualAmiiboId> {
+    // Same layout as the raw ID (see bin::AmiiboId)
+    let raw_id = get_raw_hex_bytes::<8>(info_id)?;
+    Some(fmt::VirtualAmiiboId {
+        game_character_id: u16::from_ne_bytes([raw_id[0], raw_id[1]]),
+        character_variant: raw_id[2],
+        figure_type: raw_id[3],
+        model_number: u16::from_ne_bytes([raw_id[4], raw_id[5]]),
+        series: raw_id[6]
+    })
 }
 
-fn convert_uuid(info_uuid: String) -> Vec<u8> {
+fn convert_uuid(info_uuid: String) -> Option<Vec<u8>> {
     convert_from_hex(info_uuid)
 }
 
+#[inline]
+fn make_invalid_error<P: Platform>() -> P::Error {
+    P::make_error(ErrorKind::InvalidLoadedVirtualAmiibo)
+}
+
 #[derive(Clone, Debug)]
 pub struct VirtualAmiibo {
     path: String,
@@ -120,41 +133,42 @@ pub struct VirtualAmiibo {
     tag_info: VirtualAmiiboTagInfo,
     model_info: VirtualAmiiboModelInfo,
     register_info: VirtualAmiiboRegisterInfo,
-    mii_charinfo: mii::CharInfo,
+    // None if it didn't exist and the platform can't generate miis
+    mii_charinfo: Option<fmt::MiiCharInfoData>,
 }
 
-impl super::VirtualAmiiboFormat for VirtualAmiibo {
-    fn try_load(path: String) -> Result<Self> {
+impl compat::DeprecatedVirtualAmiiboFormat for VirtualAmiibo {
+    fn try_load<P: Platform>(platform: &P, path: String) -> Result<P, Self> {
         let common_json_path = format!("{}/common.json", path);
-        let common_info = read_deserialize_json!(common_json_path.as_str() => VirtualAmiiboCommonInfo)?;
+        let common_info: VirtualAmiiboCommonInfo = util::read_deserialize_json(platform, common_json_path.as_str())?;
 
         let tag_json_path = format!("{}/tag.json", path);
-        let tag_info = read_deserialize_json!(tag_json_path.as_str() => VirtualAmiiboTagInfo)?;
+        let tag_info: VirtualAmiiboTagInfo = util::read_deserialize_json(platform, tag_json_path.as_str())?;
 
         let model_json_path = format!("{}/model.json", path);
-        let model_info = read_deserialize_json!(model_json_path.as_str() => VirtualAmiiboModelInfo)?;
+        let model_info: VirtualAmiiboModelInfo = util::read_deserialize_json(platform, model_json_path.as_str())?;
 
         let register_json_path = format!("{}/register.json", path);
-        let register_info =
-            read_deserialize_json!(register_json_path.as_str() => VirtualAmiiboRegisterInfo)?;
+        let register_info: VirtualAmiiboRegisterInfo =
+            util::read_deserialize_json(platform, register_json_path.as_str())?;
 
         let mii_charinfo_path = format!("{}/{}", path, register_info.miiCharInfo);
         // If newly generated, charinfo may not exist yet
-        let mii_charinfo = match fs::get_entry_type(mii_charinfo_path.as_str()).is_err() {
-            true => {
-                let mii_charinfo = miiext::generate_random_mii()?;
-                let mut file = fs::open_file(
-                    mii_charinfo_path.as_str(),
-                    fs::FileOpenOption::Create()
-                        | fs::FileOpenOption::Write()
-                        | fs::FileOpenOption::Append(),
-                )?;
-                file.write_val(&mii_charinfo)?;
+        let mii_charinfo = match platform.exists(mii_charinfo_path.as_str()) {
+            false => {
+                let mii_charinfo = platform.generate_random_mii()?;
+                if let Some(mii_charinfo_data) = mii_charinfo.as_ref() {
+                    platform.write_file(mii_charinfo_path.as_str(), mii_charinfo_data)?;
+                }
                 mii_charinfo
             }
-            false => {
-                let mut file = fs::open_file(mii_charinfo_path.as_str(), fs::FileOpenOption::Read())?;
-                file.read_val()?
+            true => {
+                let mii_charinfo_data = platform.read_file(mii_charinfo_path.as_str())?;
+                let mii_charinfo_data = mii_charinfo_data
+                    .get(..fmt::MII_CHARINFO_SIZE)
+                    .and_then(|data| fmt::MiiCharInfoData::try_from(data).ok());
+                result_return_unless!(mii_charinfo_data.is_some(), P, InvalidSize);
+                mii_charinfo_data
             }
         };
 
@@ -167,37 +181,46 @@ impl super::VirtualAmiiboFormat for VirtualAmiibo {
             mii_charinfo,
         })
     }
-}
 
-impl compat::DeprecatedVirtualAmiiboFormat for VirtualAmiibo {
-    fn convert(&self, _key_set: Option<bin::RetailKeySet>) -> Result<fmt::VirtualAmiibo> {
-        // Save converted amiibo
-        let name = fsext::get_path_file_name(self.path.clone());
-        let path = Self::find_convert_path(self.path.clone(), name);
-        let _ = fs::create_directory(path.as_str());
+    fn get_path(&self) -> &str {
+        self.path.as_str()
+    }
 
-        let old_areas_path = format!("{}/areas", self.path);
-        let new_areas_path = format!("{}/areas", path);
-        let _ = fs::rename_directory(old_areas_path.as_str(), new_areas_path.as_str())?;
+    fn get_convert_name(&self) -> String {
+        util::get_path_file_name(self.path.clone())
+    }
 
+    fn convert_to<P: Platform>(&self, platform: &P, _key_set: Option<&bin::RetailKeySetContext>, path: String) -> Result<P, fmt::ConvertedVirtualAmiibo> {
+        // Parsed before anything gets moved
+        let first_write_date = convert_date(&self.register_info.firstWriteDate).ok_or_else(make_invalid_error::<P>)?;
+        let last_write_date = convert_date(&self.common_info.lastWriteDate).ok_or_else(make_invalid_error::<P>)?;
+        let id = convert_amiibo_id(self.model_info.amiiboId.clone()).ok_or_else(make_invalid_error::<P>)?;
         let uuid = match self
             .tag_info
             .uuid
             .as_ref()
             .map(|uuid| convert_uuid(uuid.clone()))
         {
-            Some(uuid) => uuid,
+            Some(uuid) => uuid.ok_or_else(make_invalid_error::<P>)?,
             None => {
                 let mut uuid = [0u8; 10];
-                super::generate_random_uuid(&mut uuid)?;
+                crate::generate_random_uuid(platform, &mut uuid)?;
                 uuid.to_vec()
             }
         };
-        let mut amiibo = fmt::VirtualAmiibo {
+
+        // Save converted amiibo
+        let _ = platform.create_directory(path.as_str());
+
+        let old_areas_path = format!("{}/areas", self.path);
+        let new_areas_path = format!("{}/areas", path);
+        let _ = platform.rename_directory(old_areas_path.as_str(), new_areas_path.as_str())?;
+
+        let mut amiibo = fmt::ConvertedVirtualAmiibo {
             info: fmt::VirtualAmiiboInfo {
-                first_write_date: convert_date(&self.register_info.firstWriteDate),
-                id: convert_amiibo_id(self.model_info.amiiboId.clone()),
-                last_write_date: convert_date(&self.common_info.lastWriteDate),
+                first_write_date,
+                id,
+                last_write_date,
                 mii_charinfo_file: "mii-charinfo.bin".to_string(),
                 name: self.register_info.name.clone(),
                 uuid,
@@ -210,52 +233,52 @@ impl compat::DeprecatedVirtualAmiiboFormat for VirtualAmiibo {
             path: path.clone(),
         };
 
-        let existing_access_id = fmt::generate_areas_json(path.clone())?;
+        let existing_access_id = fmt::generate_areas_json(platform, path.as_str())?;
         if let Some(existing_id) = existing_access_id {
-            amiibo.ensure_area_registered(existing_id, fmt::DEFAULY_EMPTY_AREA_PROGRAM_ID);
+            amiibo.ensure_area_registered(existing_id, fmt::DEFAULT_EMPTY_AREA_PROGRAM_ID);
         }
 
-        amiibo.save()?;
+        amiibo.save(platform)?;
 
         // Save deprecated amiibo inside /v3 dir
         let deprecated_path = format!("{}/v3", path);
-        fs::create_directory(deprecated_path.as_str())?;
+        platform.create_directory(deprecated_path.as_str())?;
 
         // put them all in scopes so we can keep the max number of in-flight strings at 3.
         {
             let old_common_json_path = format!("{}/common.json", self.path);
             let new_common_json_path = format!("{}/common.json", deprecated_path);
-            fs::rename_file(old_common_json_path.as_str(), new_common_json_path.as_str())?;
+            platform.rename_file(old_common_json_path.as_str(), new_common_json_path.as_str())?;
         }
         {
             let old_tag_json_path = format!("{}/tag.json", self.path);
             let new_tag_json_path = format!("{}/tag.json", deprecated_path);
-            fs::rename_file(old_tag_json_path.as_str(), new_tag_json_path.as_str())?;
+            platform.rename_file(old_tag_json_path.as_str(), new_tag_json_path.as_str())?;
         }
         {
             let old_model_json_path = format!("{}/model.json", self.path);
             let new_model_json_path = format!("{}/model.json", deprecated_path);
-            fs::rename_file(old_model_json_path.as_str(), new_model_json_path.as_str())?;
+            platform.rename_file(old_model_json_path.as_str(), new_model_json_path.as_str())?;
         }
         {
             let old_register_json_path = format!("{}/register.json", self.path);
             let new_register_json_path = format!("{}/register.json", deprecated_path);
-            fs::rename_file(
+            platform.rename_file(
                 old_register_json_path.as_str(),
                 new_register_json_path.as_str(),
             )?;
         }
-        {
+        if self.mii_charinfo.is_some() {
             let old_mii_charinfo_path = format!("{}/{}", self.path, self.register_info.miiCharInfo);
             let new_mii_charinfo_path =
                 format!("{}/{}", deprecated_path, self.register_info.miiCharInfo);
-            fs::rename_file(
+            platform.rename_file(
                 old_mii_charinfo_path.as_str(),
                 new_mii_charinfo_path.as_str(),
             )?;
         }
         if self.path != path {
-            fs::remove_dir_all(self.path.as_str())?;
+            platform.remove_dir_all(self.path.as_str())?;
         }
 
         Ok(amiibo)
@@ -0,0 +1,242 @@
+use std::collections::HashSet;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::process::ExitCode;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use std::thread;
+use emuiibo_amiibo::bin;
+use emuiibo_amiibo::compat::{self, DeprecatedVirtualAmiiboFormat};
+use emuiibo_amiibo::fmt;
+use emuiibo_amiibo::v1;
+
+mod platform;
+use platform::HostPlatform;
+
+mod meta;
+use meta::MetaMode;
+
+// Bulk raw dump converter/validator: prepares large collections on a PC, instead of emuiibo converting them one by one at boot
+// Dumps get converted in parallel by the same code as emuiibo's own conversions (see the emuiibo-amiibo crate), then loaded back like emuiibo does
+// It also creates/exports amiibo-meta.bin sidecars (see meta.rs)
+
+const VIRTUAL_AMIIBO_DIR: &str = "emuiibo/amiibo";
+
+struct Options {
+    dumps_dir: PathBuf,
+    sd_root: Option<PathBuf>,
+    key_set_path: Option<PathBuf>,
+    job_count: usize,
+    check_only: bool
+}
+
+struct Job {
+    dump_path: PathBuf,
+    amiibo_path: String
+}
+
+fn parse_options(args: &[String]) -> Option<Options> {
+    let mut positional = Vec::new();
+    let mut key_set_path = None;
+    let mut job_count = 0;
+    let mut check_only = false;
+
+    let mut args_iter = args.iter();
+    while let Some(arg) = args_iter.next() {
+        match arg.as_str() {
+            "--check" => check_only = true,
+            "--keys" => key_set_path = Some(PathBuf::from(args_iter.next()?)),
+            "--jobs" => job_count = args_iter.next()?.parse().ok()?,
+            _ if arg.starts_with("--") => return None,
+            _ => positional.push(PathBuf::from(arg))
+        }
+    }
+
+    let mut positional = positional.into_iter();
+    let dumps_dir = positional.next()?;
+    let sd_root = positional.next();
+    if positional.next().is_some() || (sd_root.is_none() && !check_only) {
+        return None;
+    }
+
+    if job_count == 0 {
+        job_count = thread::available_parallelism().map(|count| count.get()).unwrap_or(1);
+    }
+    let key_set_path = key_set_path.or_else(|| sd_root.as_ref().map(|sd_root| sd_root.join("switch").join(compat::RETAIL_KEY_SET_FILE_NAME)));
+    Some(Options { dumps_dir, sd_root, key_set_path, job_count, check_only })
+}
+
+fn find_dumps(dir: &Path, out_dump_paths: &mut Vec<PathBuf>) {
+    let Ok(entries) = fs::read_dir(dir) else {
+        return;
+    };
+
+    for entry in entries.flatten() {
+        let path = entry.path();
+        if path.is_dir() {
+            find_dumps(&path, out_dump_paths);
+        }
+        else if path.extension().is_some_and(|ext| ext.eq_ignore_ascii_case("bin")) {
+            out_dump_paths.push(path);
+        }
+    }
+}
+
+fn make_jobs(opts: &Options) -> Vec<Job> {
+    let mut dump_paths = Vec::new();
+    find_dumps(&opts.dumps_dir, &mut dump_paths);
+    // Sorted, so that duplicate names always get the same suffixes
+    dump_paths.sort();
+
+    // Same naming as DeprecatedVirtualAmiiboFormat::find_convert_path, decided upfront since jobs run in parallel
+    let amiibo_dir = opts.sd_root.as_ref().map(|sd_root| sd_root.join(VIRTUAL_AMIIBO_DIR).to_string_lossy().into_owned()).unwrap_or_default();
+    let mut used_paths = HashSet::new();
+    let mut jobs = Vec::with_capacity(dump_paths.len());
+    for dump_path in dump_paths {
+        let name = dump_path.file_stem().map(|stem| stem.to_string_lossy().into_owned()).unwrap_or_default();
+        let mut amiibo_path = format!("{}/{}", amiibo_dir, name);
+        let mut name_idx: usize = 0;
+        while used_paths.contains(&amiibo_path) || Path::new(&amiibo_path).exists() {
+            name_idx += 1;
+            amiibo_path = format!("{}/{}_{}", amiibo_dir, name, name_idx);
+        }
+        used_paths.insert(amiibo_path.clone());
+        jobs.push(Job { dump_path, amiibo_path });
+    }
+    jobs
+}
+
+fn load_retail_key_set(path: &Path) -> Option<bin::RetailKeySetContext> {
+    let key_set_data = fs::read(path).ok()?;
+    let key_set = bin::RetailKeySet::from_bytes(&key_set_data)?;
+    Some(bin::RetailKeySetContext::new(&key_set))
+}
+
+fn run_job(platform: &HostPlatform, job: &Job, key_set: Option<&bin::RetailKeySetContext>, check_only: bool) -> Result<String, String> {
+    let dump_path = job.dump_path.to_str().ok_or("non UTF-8 path")?;
+    let amiibo = v1::VirtualAmiibo::try_load(platform, dump_path.to_string()).map_err(|err| format!("not an amiibo dump ({})", err))?;
+
+    let amiibo_id = amiibo.get_raw_bin().st_1.amiibo_id;
+    if (amiibo_id.game_character_id == 0) && (amiibo_id.series == 0) && (amiibo_id.model_number == 0) {
+        return Err("empty amiibo ID".to_string());
+    }
+
+    if check_only {
+        let conv_bin = bin::ConvertedFormat::from_raw(amiibo.get_raw_bin());
+        let plain_bin = match key_set {
+            Some(key_set_v) => bin::PlainFormat::decrypt_from_converted(&conv_bin, key_set_v).map_err(|kind| format!("unable to decrypt ({:?})", kind))?,
+            None => bin::PlainFormat::from_converted(&conv_bin)
+        };
+        let name_be = plain_bin.dec_data.settings.name_be;
+        let name = name_be.get_string();
+        return Ok(match name.is_empty() {
+            true => "valid".to_string(),
+            false => format!("valid, named '{}'", name)
+        });
+    }
+
+    amiibo.convert_to(platform, key_set, job.amiibo_path.clone()).map_err(|err| format!("unable to convert ({})", err))?;
+
+    // Loaded back exactly like emuiibo will
+    let loaded_amiibo = fmt::load(platform, job.amiibo_path.as_str()).map_err(|err| format!("converted, but unable to load ({})", err))?;
+    Ok(format!("converted to {} ('{}')", job.amiibo_path, loaded_amiibo.info.name))
+}
+
+fn run_jobs(jobs: &[Job], key_set: Option<&bin::RetailKeySetContext>, opts: &Options) -> Vec<Result<String, String>> {
+    // The original dumps are copied instead of moved
+    let platform = HostPlatform { keep_sources: true };
+    let results: Mutex<Vec<Option<Result<String, String>>>> = Mutex::new(jobs.iter().map(|_| None).collect());
+    let next_job_idx = AtomicUsize::new(0);
+
+    let worker_fn = || {
+        loop {
+            let job_idx = next_job_idx.fetch_add(1, Ordering::Relaxed);
+            let Some(job) = jobs.get(job_idx) else {
+                break;
+            };
+
+            let result = run_job(&platform, job, key_set, opts.check_only);
+            results.lock().unwrap()[job_idx] = Some(result);
+        }
+    };
+
+    let worker_count = opts.job_count.min(jobs.len());
+    thread::scope(|scope| {
+        for _ in 1..worker_count {
+            scope.spawn(worker_fn);
+        }
+        worker_fn();
+    });
+
+    results.into_inner().unwrap().into_iter().map(|result| result.unwrap_or_else(|| Err("not run".to_string()))).collect()
+}
+
+fn print_usage(program: &str) {
+    eprintln!("Usage: {} [--keys <key_retail.bin>] [--jobs <count>] <dumps-dir> <sd-root>", program);
+    eprintln!("       {} --check [--keys <key_retail.bin>] [--jobs <count>] <dumps-dir>", program);
+    eprintln!("       {} --to-meta|--from-meta <amiibo-dir>...", program);
+}
+
+fn main() -> ExitCode {
+    let args: Vec<String> = std::env::args().collect();
+    let program = args.first().map(String::as_str).unwrap_or("emuiibo-convert");
+    let meta_mode = match args.get(1).map(String::as_str) {
+        Some("--to-meta") => Some(MetaMode::ToMeta),
+        Some("--from-meta") => Some(MetaMode::FromMeta),
+        _ => None
+    };
+    if let Some(meta_mode_v) = meta_mode {
+        if args.len() < 3 {
+            print_usage(program);
+            return ExitCode::FAILURE;
+        }
+        let amiibo_paths: Vec<PathBuf> = args[2..].iter().map(PathBuf::from).collect();
+        return match meta::run(meta_mode_v, &amiibo_paths) {
+            0 => ExitCode::SUCCESS,
+            _ => ExitCode::FAILURE
+        };
+    }
+
+    let Some(opts) = parse_options(&args[1..]) else {
+        print_usage(program);
+        return ExitCode::FAILURE;
+    };
+    if !opts.dumps_dir.is_dir() {
+        eprintln!("'{}' is not a directory", opts.dumps_dir.display());
+        return ExitCode::FAILURE;
+    }
+    if let Some(sd_root) = opts.sd_root.as_ref() {
+        if let Err(err) = fs::create_dir_all(sd_root.join(VIRTUAL_AMIIBO_DIR)) {
+            eprintln!("Unable to create '{}': {}", sd_root.join(VIRTUAL_AMIIBO_DIR).display(), err);
+            return ExitCode::FAILURE;
+        }
+    }
+
+    // Loaded once and shared by every conversion
+    let key_set = opts.key_set_path.as_deref().and_then(load_retail_key_set);
+    match key_set {
+        Some(_) => eprintln!("Using {}: dumps will be decrypted", opts.key_set_path.as_ref().unwrap().display()),
+        None => eprintln!("No {}: dumps won't be decrypted (no application area, default settings)", compat::RETAIL_KEY_SET_FILE_NAME)
+    }
+
+    let jobs = make_jobs(&opts);
+    eprintln!("{} {} dumps with {} jobs...", if opts.check_only { "Checking" } else { "Converting" }, jobs.len(), opts.job_count.min(jobs.len()));
+    let results = run_jobs(&jobs, key_set.as_ref(), &opts);
+
+    let mut failed_count: usize = 0;
+    for (job, result) in jobs.iter().zip(results.iter()) {
+        match result {
+            Ok(msg) => println!("[ok]   {}: {}", job.dump_path.display(), msg),
+            Err(msg) => {
+                println!("[fail] {}: {}", job.dump_path.display(), msg);
+                failed_count += 1;
+            }
+        }
+    }
+    println!("{} dumps, {} failed", jobs.len(), failed_count);
+
+    match failed_count {
+        0 => ExitCode::SUCCESS,
+        _ => ExitCode::FAILURE
+    }
+}
@@ -0,0 +1,88 @@
+use std::fs;
+use std::path::{Path, PathBuf};
+use emuiibo_amiibo::{fmt, meta};
+use crate::platform::{HostError, HostPlatform};
+
+// amiibo-meta.bin sidecars on a PC: created from (or exported back to) amiibo.json/areas.json with the same code as emuiibo
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+pub enum MetaMode {
+    // amiibo.json/areas.json -> amiibo-meta.bin
+    ToMeta,
+    // amiibo-meta.bin -> amiibo.json/areas.json
+    FromMeta
+}
+
+fn to_meta(platform: &HostPlatform, amiibo_path: &str) -> Result<String, HostError> {
+    // Loaded exactly like emuiibo does when importing the JSONs
+    let loaded_amiibo = fmt::load(platform, amiibo_path)?;
+    if loaded_amiibo.needs_save {
+        fmt::save_info(platform, amiibo_path, &loaded_amiibo.info)?;
+    }
+
+    // An existing sidecar keeps its area capacity, since it's overwritten in place
+    let mut area_capacity = meta::read(platform, amiibo_path).map(|loaded_meta| loaded_meta.area_capacity).unwrap_or(0);
+    let json_hash = meta::hash_json_files(platform, amiibo_path);
+    meta::write(platform, amiibo_path, &loaded_amiibo.info, &loaded_amiibo.areas, json_hash, &mut area_capacity)?;
+    Ok(format!("created {} ('{}', {} areas)", meta::META_FILE_NAME, loaded_amiibo.info.name, loaded_amiibo.areas.areas.len()))
+}
+
+fn from_meta(platform: &HostPlatform, amiibo_path: &str) -> Result<String, HostError> {
+    let mut loaded_meta = meta::read(platform, amiibo_path)?;
+    fmt::save_info(platform, amiibo_path, &loaded_meta.info)?;
+    fmt::save_areas(platform, amiibo_path, &loaded_meta.areas)?;
+
+    // Now in sync with the exported JSONs, otherwise emuiibo would import them again
+    let json_hash = meta::hash_json_files(platform, amiibo_path);
+    meta::write(platform, amiibo_path, &loaded_meta.info, &loaded_meta.areas, json_hash, &mut loaded_meta.area_capacity)?;
+    Ok(format!("exported amiibo.json/areas.json ('{}', {} areas)", loaded_meta.info.name, loaded_meta.areas.areas.len()))
+}
+
+fn find_virtual_amiibos(platform: &HostPlatform, path: &Path, out_amiibo_paths: &mut Vec<String>) {
+    let path_str = path.to_string_lossy().into_owned();
+    if fmt::is_virtual_amiibo(platform, path_str.as_str()) {
+        out_amiibo_paths.push(path_str);
+        return;
+    }
+
+    // Otherwise a directory of virtual amiibos (like sd:/emuiibo/amiibo), which might have nested folders
+    let Ok(entries) = fs::read_dir(path) else {
+        return;
+    };
+    let mut sub_paths: Vec<PathBuf> = entries.flatten().map(|entry| entry.path()).filter(|sub_path| sub_path.is_dir()).collect();
+    sub_paths.sort();
+    for sub_path in sub_paths {
+        find_virtual_amiibos(platform, &sub_path, out_amiibo_paths);
+    }
+}
+
+// Returns the number of failed virtual amiibos
+pub fn run(mode: MetaMode, paths: &[PathBuf]) -> usize {
+    let platform = HostPlatform { keep_sources: false };
+    let mut amiibo_paths = Vec::new();
+    let mut failed_count: usize = 0;
+    for path in paths {
+        if !path.is_dir() {
+            println!("[fail] {}: not a directory", path.display());
+            failed_count += 1;
+            continue;
+        }
+        find_virtual_amiibos(&platform, path, &mut amiibo_paths);
+    }
+
+    for amiibo_path in amiibo_paths.iter() {
+        let result = match mode {
+            MetaMode::ToMeta => to_meta(&platform, amiibo_path),
+            MetaMode::FromMeta => from_meta(&platform, amiibo_path)
+        };
+        match result {
+            Ok(msg) => println!("[ok]   {}: {}", amiibo_path, msg),
+            Err(err) => {
+                println!("[fail] {}: {}", amiibo_path, err);
+                failed_count += 1;
+            }
+        }
+    }
+    println!("{} virtual amiibos, {} failed", amiibo_paths.len(), failed_count);
+    failed_count
+}
@@ -0,0 +1,140 @@
+use std::fs;
+use std::hash::{BuildHasher, Hasher, RandomState};
+use std::io::{self, Write};
+use std::path::Path;
+use emuiibo_amiibo::fmt::MiiCharInfoData;
+use emuiibo_amiibo::{ErrorKind, Platform, Result};
+
+#[derive(Debug)]
+pub enum HostError {
+    Io(io::Error),
+    Amiibo(ErrorKind)
+}
+
+impl From<io::Error> for HostError {
+    fn from(err: io::Error) -> Self {
+        Self::Io(err)
+    }
+}
+
+impl std::fmt::Display for HostError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            Self::Io(err) => write!(f, "{}", err),
+            Self::Amiibo(kind) => write!(f, "{:?}", kind)
+        }
+    }
+}
+
+// emuiibo's SD card accesses over a regular directory tree
+pub struct HostPlatform {
+    // Sources get copied instead of moved (and never removed), so that conversions leave them untouched
+    pub keep_sources: bool
+}
+
+fn copy_directory(old_path: &Path, new_path: &Path) -> io::Result<()> {
+    fs::create_dir_all(new_path)?;
+    for entry in fs::read_dir(old_path)? {
+        let entry = entry?;
+        let new_entry_path = new_path.join(entry.file_name());
+        if entry.file_type()?.is_dir() {
+            copy_directory(&entry.path(), &new_entry_path)?;
+        }
+        else {
+            fs::copy(entry.path(), new_entry_path)?;
+        }
+    }
+    Ok(())
+}
+
+impl Platform for HostPlatform {
+    type Error = HostError;
+
+    fn make_error(kind: ErrorKind) -> HostError {
+        HostError::Amiibo(kind)
+    }
+
+    fn read_file(&self, path: &str) -> Result<Self, Vec<u8>> {
+        Ok(fs::read(path)?)
+    }
+
+    fn write_file(&self, path: &str, data: &[u8]) -> Result<Self, ()> {
+        Ok(fs::write(path, data)?)
+    }
+
+    fn overwrite_file(&self, path: &str, data: &[u8]) -> Result<Self, ()> {
+        let mut file = fs::OpenOptions::new().write(true).create(true).truncate(false).open(path)?;
+        Ok(file.write_all(data)?)
+    }
+
+    fn create_file(&self, path: &str) -> Result<Self, ()> {
+        fs::OpenOptions::new().write(true).create_new(true).open(path)?;
+        Ok(())
+    }
+
+    fn exists(&self, path: &str) -> bool {
+        Path::new(path).exists()
+    }
+
+    fn is_file(&self, path: &str) -> bool {
+        Path::new(path).is_file()
+    }
+
+    fn create_directory(&self, path: &str) -> Result<Self, ()> {
+        Ok(fs::create_dir(path)?)
+    }
+
+    fn list_files(&self, path: &str) -> Result<Self, Vec<String>> {
+        let mut names = Vec::new();
+        for entry in fs::read_dir(path)? {
+            let entry = entry?;
+            if entry.file_type()?.is_file() {
+                if let Ok(name) = entry.file_name().into_string() {
+                    names.push(name);
+                }
+            }
+        }
+        Ok(names)
+    }
+
+    fn rename_file(&self, old_path: &str, new_path: &str) -> Result<Self, ()> {
+        if self.keep_sources {
+            fs::copy(old_path, new_path)?;
+        }
+        else {
+            fs::rename(old_path, new_path)?;
+        }
+        Ok(())
+    }
+
+    fn rename_directory(&self, old_path: &str, new_path: &str) -> Result<Self, ()> {
+        if self.keep_sources {
+            copy_directory(Path::new(old_path), Path::new(new_path))?;
+        }
+        else {
+            fs::rename(old_path, new_path)?;
+        }
+        Ok(())
+    }
+
+    fn remove_dir_all(&self, path: &str) -> Result<Self, ()> {
+        if !self.keep_sources {
+            fs::remove_dir_all(path)?;
+        }
+        Ok(())
+    }
+
+    fn fill_random(&self, buf: &mut [u8]) -> Result<Self, ()> {
+        // Not cryptographically secure, which is fine for UUIDs: every RandomState gets different keys
+        for chunk in buf.chunks_mut(8) {
+            let val = RandomState::new().build_hasher().finish();
+            chunk.copy_from_slice(&val.to_le_bytes()[..chunk.len()]);
+        }
+        Ok(())
+    }
+
+    fn generate_random_mii(&self) -> Result<Self, Option<MiiCharInfoData>> {
+        // No mii database here: emuiibo generates the mii when the virtual amiibo gets loaded
+        Ok(None)
+    }
+}
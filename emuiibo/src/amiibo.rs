@@ -1,21 +1,21 @@
 use alloc::string::String;
+use alloc::vec::Vec;
+use nx::fs;
 use nx::result::*;
+use nx::service::mii;
+use nx::svc::rc::ResultInvalidSize;
+use crate::{rc, fsext, miiext};
 
-pub mod compat;
-
-pub mod ntag;
-
-pub mod bin;
-
-pub mod v1;
+// The formats themselves (and their conversions) live in the emuiibo-amiibo crate, shared with the PC tools
+pub use emuiibo_amiibo::{bin, ntag, v1, v2, v3};
 
-pub mod v2;
-
-pub mod v3;
+pub mod compat;
 
 pub mod fmt;
 
-pub const APP_AREA_SIZE: usize = 0xD8;
+pub mod meta;
+
+pub use emuiibo_amiibo::APP_AREA_SIZE;
 
 pub const VIRTUAL_AMIIBO_DIR: &'static str = "sdmc:/emuiibo/amiibo";
 pub const DEPRECATED_VIRTUAL_AMIIBO_DIR: &'static str = "sdmc:/emuiibo";
@@ -24,11 +24,106 @@ pub trait VirtualAmiiboFormat {
     fn try_load(path: String) -> Result<Self> where Self: Sized;
 }
 
+const_assert!(core::mem::size_of::<mii::CharInfo>() == emuiibo_amiibo::fmt::MII_CHARINFO_SIZE);
+
+// The formats' accesses to the SD card, RNG and mii database
+pub struct SdPlatform;
+
+impl emuiibo_amiibo::Platform for SdPlatform {
+    type Error = ResultCode;
+
+    fn make_error(kind: emuiibo_amiibo::ErrorKind) -> ResultCode {
+        use emuiibo_amiibo::ErrorKind;
+        match kind {
+            ErrorKind::InvalidSize => ResultInvalidSize::make(),
+            ErrorKind::InvalidJsonSerialization => rc::ResultInvalidJsonSerialization::make(),
+            ErrorKind::InvalidJsonDeserialization => rc::ResultInvalidJsonDeserialization::make(),
+            ErrorKind::VirtualAmiiboFlagNotFound => rc::ResultVirtualAmiiboFlagNotFound::make(),
+            ErrorKind::VirtualAmiiboJsonNotFound => rc::ResultVirtualAmiiboJsonNotFound::make(),
+            ErrorKind::VirtualAmiiboAreasJsonNotFound => rc::ResultVirtualAmiiboAreasJsonNotFound::make(),
+            ErrorKind::InvalidLoadedVirtualAmiibo => rc::ResultInvalidLoadedVirtualAmiibo::make(),
+            ErrorKind::InvalidVirtualAmiiboMeta => rc::ResultInvalidVirtualAmiiboMeta::make()
+        }
+    }
+
+    fn read_file(&self, path: &str) -> Result<Vec<u8>> {
+        let mut file = fs::open_file(path, fs::FileOpenOption::Read())?;
+        let mut data: Vec<u8> = vec![0; file.get_size()?];
+        file.read_array(&mut data)?;
+        Ok(data)
+    }
+
+    fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
+        let _ = fs::remove_file(path);
+        let mut file = fs::open_file(path, fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+        file.write_array(data)?;
+        Ok(())
+    }
+
+    fn overwrite_file(&self, path: &str, data: &[u8]) -> Result<()> {
+        let mut file = fs::open_file(path, fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+        file.write_array(data)?;
+        Ok(())
+    }
+
+    fn create_file(&self, path: &str) -> Result<()> {
+        fs::create_file(path, 0, fs::FileAttribute::None())
+    }
+
+    fn exists(&self, path: &str) -> bool {
+        fs::get_entry_type(path).is_ok()
+    }
+
+    fn is_file(&self, path: &str) -> bool {
+        fsext::exists_file(path)
+    }
+
+    fn create_directory(&self, path: &str) -> Result<()> {
+        fs::create_directory(path)
+    }
+
+    fn list_files(&self, path: &str) -> Result<Vec<String>> {
+        let mut dir = fs::open_directory(path, fs::DirectoryOpenMode::ReadFiles())?;
+        let mut names: Vec<String> = Vec::new();
+        loop {
+            if let Ok(Some(entry)) = dir.read_next() {
+                if let Ok(name) = entry.name.get_str() {
+                    names.push(String::from(name));
+                }
+            }
+            else {
+                break;
+            }
+        }
+        Ok(names)
+    }
+
+    fn rename_file(&self, old_path: &str, new_path: &str) -> Result<()> {
+        fs::rename_file(old_path, new_path)
+    }
+
+    fn rename_directory(&self, old_path: &str, new_path: &str) -> Result<()> {
+        fs::rename_directory(old_path, new_path)
+    }
+
+    fn remove_dir_all(&self, path: &str) -> Result<()> {
+        fs::remove_dir_all(path)
+    }
+
+    fn fill_random(&self, buf: &mut [u8]) -> Result<()> {
+        use nx::rand::RngCore;
+        nx::rand::get_rng()?.fill_bytes(buf);
+        Ok(())
+    }
+
+    fn generate_random_mii(&self) -> Result<Option<emuiibo_amiibo::fmt::MiiCharInfoData>> {
+        let mii_charinfo = miiext::generate_random_mii()?;
+        // SAFETY: same size (asserted above), and the charinfo is plain data
+        Ok(Some(unsafe { core::mem::transmute::<mii::CharInfo, emuiibo_amiibo::fmt::MiiCharInfoData>(mii_charinfo) }))
+    }
+}
+
+#[inline]
 pub fn generate_random_uuid(uuid: &mut [u8;10]) -> Result<()> {
-    use nx::rand::RngCore;
-    nx::rand::get_rng()?.fill_bytes(&mut uuid[..7]);
-    uuid[7] = 0;
-    uuid[8] = 0;
-    uuid[9] = 0;
-    Ok(())
-}
\ No newline at end of file
+    emuiibo_amiibo::generate_random_uuid(&SdPlatform, uuid)
+}
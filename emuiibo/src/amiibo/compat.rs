@@ -1,90 +1,191 @@
 use nx::{result::*, fs};
 use crate::amiibo::bin;
+use crate::fsext;
+use emuiibo_amiibo::compat::DeprecatedVirtualAmiiboFormat;
 
-use super::{v1, v2, v3, fmt, VirtualAmiiboFormat};
-use alloc::string::String;
+use super::{v1, v2, v3, SdPlatform};
 
 pub(crate) const RETAIL_KEY_SET_FILE: &str = "sdmc:/switch/key_retail.bin";
 
-pub trait DeprecatedVirtualAmiiboFormat: super::VirtualAmiiboFormat {
-    fn convert(&self, key_set: Option<bin::RetailKeySet>) -> Result<fmt::VirtualAmiibo>;
+/*
+Conversion manifest (compat_manifest.bin): a hash of each scanned directory's entry names, saved once every deprecated virtual amiibo in it was converted.
+On boot, directories whose entries didn't change since then are skipped without probing any of them.
+*/
 
-    fn find_convert_path(old_path: String, name: String) -> String {
-        let mut path = format!("{}/{}", super::VIRTUAL_AMIIBO_DIR, name);
+const COMPAT_MANIFEST_PATH: &str = "sdmc:/emuiibo/compat_manifest.bin";
+const COMPAT_MANIFEST_MAGIC: u32 = u32::from_le_bytes(*b"ECMP");
 
-        if path == old_path {
-            return path;
-        }
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+struct CompatManifest {
+    magic: u32,
+    reserved: u32,
+    deprecated_dir_hash: u64,
+    dir_hash: u64
+}
 
-        let mut name_idx: usize = 0;
-        loop {
-            // Path already exists
-            if fs::get_entry_type(path.as_str()).is_ok() {
-                name_idx += 1;
-                path = format!("{}/{}_{}", super::VIRTUAL_AMIIBO_DIR, name, name_idx);
-            }
-            else {
-                break;
-            }
-        }
+fn read_compat_manifest() -> CompatManifest {
+    let read_impl = || -> Result<CompatManifest> {
+        let mut file = fs::open_file(COMPAT_MANIFEST_PATH, fs::FileOpenOption::Read())?;
+        file.read_val()
+    };
 
-        path
+    match read_impl() {
+        Ok(manifest) if manifest.magic == COMPAT_MANIFEST_MAGIC => manifest,
+        // Missing or invalid: everything gets scanned
+        _ => Default::default()
     }
 }
 
-fn convert_deprecated_virtual_amiibos_in_dir(path: &str) -> Result<()> {
-    let mut key_set: Option<bin::RetailKeySet> = None;
-    let key_set_file = fs::open_file(RETAIL_KEY_SET_FILE, fs::FileOpenOption::Read());
-    if let Ok(mut key_set_file) = key_set_file {
-        if let Ok(key_set_v) = key_set_file.read_val::<bin::RetailKeySet>() {
-            log!("Found key_retail.bin --- old amiibo / raw dump conversions will include encrypted sections too!");
-            key_set = Some(key_set_v);
-        }
+fn write_compat_manifest(manifest: &CompatManifest) -> Result<()> {
+    let _ = fs::remove_file(COMPAT_MANIFEST_PATH);
+    let mut file = fs::open_file(COMPAT_MANIFEST_PATH, fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+    file.write_val(manifest)
+}
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+enum EntryKind {
+    Current,
+    V1,
+    V2,
+    V3,
+    Unknown
+}
+
+fn is_v1_candidate(entry_name: &str) -> bool {
+    // Raw dumps, which share the deprecated directory with our own binary files
+    entry_name.to_lowercase().ends_with(".bin") && (entry_name != "trace.bin") && (entry_name != "compat_manifest.bin")
+}
+
+// A single check per entry: the format is detected by its files, and only that format gets loaded
+fn classify_entry(entry_path: &str, entry_name: &str, is_file: bool) -> EntryKind {
+    if is_file {
+        if is_v1_candidate(entry_name) { EntryKind::V1 } else { EntryKind::Unknown }
     }
+    else if fsext::exists_file(format!("{}/amiibo.flag", entry_path)) {
+        EntryKind::Current
+    }
+    else if fsext::exists_file(format!("{}/amiibo.bin", entry_path)) {
+        EntryKind::V2
+    }
+    else if fsext::exists_file(format!("{}/tag.json", entry_path)) {
+        EntryKind::V3
+    }
+    else {
+        EntryKind::Unknown
+    }
+}
 
+fn hash_entry_names(path: &str) -> Result<u64> {
     let mut dir = fs::open_directory(path, fs::DirectoryOpenMode::ReadDirectories() | fs::DirectoryOpenMode::ReadFiles())?;
 
-    loop {
-        if let Some(entry) = dir.read_next()? {
-            let entry_path = format!("{}/{:?}", path, entry.name);
-            log!("Analyzing entry '{}'...\n", entry_path);
-
-            let maybe_new_amiibo = {
-                if let Ok(v1_amiibo) = v1::VirtualAmiibo::try_load(entry_path.clone()) {
-                    log!("Loaded v1 amiibo {:?} - converting it...\n", v1_amiibo);
-                    Some(v1_amiibo.convert(key_set))
-                }
-                else if let Ok(v2_amiibo) = v2::VirtualAmiibo::try_load(entry_path.clone()) {
-                    log!("Loaded v2 amiibo {:?} - converting it...\n", v2_amiibo);
-                    Some(v2_amiibo.convert(key_set))
-                }
-                else if let Ok(v3_amiibo) = v3::VirtualAmiibo::try_load(entry_path.clone()) {
-                    log!("Loaded v3 amiibo {:?} - converting it...\n", v3_amiibo);
-                    Some(v3_amiibo.convert(key_set))
-                }
-                else {
-                    None
-                }
-            };
-            
-            if let Some(new_amiibo_rc) = maybe_new_amiibo {
-                match new_amiibo_rc {
-                    Ok(new_amiibo) => log!("Converted new amiibo: {:?}\n", new_amiibo),
-                    Err(rc) => log!("Conversion failed: {0} / {0:?}\n", rc)
-                };
-            }
+    // Order-independent (the FS doesn't guarantee any order), FNV-1a of each name combined by addition
+    let mut hash: u64 = 0;
+    while let Some(entry) = dir.read_next()? {
+        let entry_name = format!("{:?}", entry.name);
+        if entry_name == "compat_manifest.bin" {
+            continue;
         }
-        else {
-            break;
+
+        let mut name_hash: u64 = 0xCBF29CE484222325;
+        for byte in entry_name.as_bytes() {
+            name_hash ^= *byte as u64;
+            name_hash = name_hash.wrapping_mul(0x100000001B3);
         }
+        hash = hash.wrapping_add(name_hash);
     }
+    Ok(hash)
+}
+
+// Returns whether every deprecated virtual amiibo in the directory got converted
+fn convert_deprecated_virtual_amiibos_in_dir(path: &str, key_set: &mut Option<Option<bin::RetailKeySetContext>>) -> Result<bool> {
+    let mut dir = fs::open_directory(path, fs::DirectoryOpenMode::ReadDirectories() | fs::DirectoryOpenMode::ReadFiles())?;
 
-    Ok(())
+    let mut all_converted = true;
+    while let Some(entry) = dir.read_next()? {
+        let entry_name = format!("{:?}", entry.name);
+        let entry_path = format!("{}/{}", path, entry_name);
+        let entry_kind = classify_entry(entry_path.as_str(), entry_name.as_str(), entry.entry_type == fs::DirectoryEntryType::File);
+        if (entry_kind == EntryKind::Current) || (entry_kind == EntryKind::Unknown) {
+            continue;
+        }
+        log!("Analyzing entry '{}' ({:?})...\n", entry_path, entry_kind);
+
+        // Only loaded once something actually needs to be converted, then shared by every conversion
+        let key_set_ctx = key_set.get_or_insert_with(load_retail_key_set).as_ref();
+
+        let maybe_new_amiibo = match entry_kind {
+            EntryKind::V1 => v1::VirtualAmiibo::try_load(&SdPlatform, entry_path.clone()).map(|v1_amiibo| {
+                log!("Loaded v1 amiibo {:?} - converting it...\n", v1_amiibo);
+                v1_amiibo.convert(&SdPlatform, key_set_ctx, super::VIRTUAL_AMIIBO_DIR)
+            }).ok(),
+            EntryKind::V2 => v2::VirtualAmiibo::try_load(&SdPlatform, entry_path.clone()).map(|v2_amiibo| {
+                log!("Loaded v2 amiibo {:?} - converting it...\n", v2_amiibo);
+                v2_amiibo.convert(&SdPlatform, key_set_ctx, super::VIRTUAL_AMIIBO_DIR)
+            }).ok(),
+            EntryKind::V3 => v3::VirtualAmiibo::try_load(&SdPlatform, entry_path.clone()).map(|v3_amiibo| {
+                log!("Loaded v3 amiibo {:?} - converting it...\n", v3_amiibo);
+                v3_amiibo.convert(&SdPlatform, key_set_ctx, super::VIRTUAL_AMIIBO_DIR)
+            }).ok(),
+            _ => None
+        };
+
+        match maybe_new_amiibo {
+            Some(Ok(new_amiibo)) => log!("Converted new amiibo: {:?}\n", new_amiibo),
+            Some(Err(rc)) => {
+                log!("Conversion failed: {0} / {0:?}\n", rc);
+                all_converted = false;
+            },
+            // Not actually a deprecated virtual amiibo (a random .bin file...)
+            None => {}
+        };
+    }
+
+    Ok(all_converted)
+}
+
+fn load_retail_key_set() -> Option<bin::RetailKeySetContext> {
+    let mut key_set_file = fs::open_file(RETAIL_KEY_SET_FILE, fs::FileOpenOption::Read()).ok()?;
+    let key_set = key_set_file.read_val::<bin::RetailKeySet>().ok()?;
+    log!("Found key_retail.bin --- old amiibo / raw dump conversions will include encrypted sections too!\n");
+    Some(bin::RetailKeySetContext::new(&key_set))
+}
+
+// Scans a directory unless its entries didn't change since it was last fully converted, returns the hash to save in the manifest
+fn convert_deprecated_virtual_amiibos_in_dir_if_changed(path: &str, saved_hash: u64, key_set: &mut Option<Option<bin::RetailKeySetContext>>) -> u64 {
+    let hash = match hash_entry_names(path) {
+        Ok(hash) => hash,
+        Err(_) => return 0
+    };
+    if hash == saved_hash {
+        log!("Skipping unchanged dir '{}'...\n", path);
+        return hash;
+    }
+
+    log!("Analyzing dir '{}'...\n", path);
+    match convert_deprecated_virtual_amiibos_in_dir(path, key_set) {
+        // Conversions move/create entries, so hash them again
+        Ok(true) => hash_entry_names(path).unwrap_or(0),
+        // Try again next time
+        _ => 0
+    }
 }
 
+// Only lists both directories when nothing changed since last boot, so it stays at boot (conversions create areas through the scratch arena, which is limited to the main/IPC thread)
 pub fn convert_deprecated_virtual_amiibos() {
-    log!("Analyzing deprecated dir...\n");
-    let _ = convert_deprecated_virtual_amiibos_in_dir(super::DEPRECATED_VIRTUAL_AMIIBO_DIR);
-    log!("Analyzing regular dir...\n");
-    let _ = convert_deprecated_virtual_amiibos_in_dir(super::VIRTUAL_AMIIBO_DIR);
-}
\ No newline at end of file
+    let manifest = read_compat_manifest();
+    let mut key_set: Option<Option<bin::RetailKeySetContext>> = None;
+
+    let new_manifest = CompatManifest {
+        magic: COMPAT_MANIFEST_MAGIC,
+        reserved: 0,
+        deprecated_dir_hash: convert_deprecated_virtual_amiibos_in_dir_if_changed(super::DEPRECATED_VIRTUAL_AMIIBO_DIR, manifest.deprecated_dir_hash, &mut key_set),
+        dir_hash: convert_deprecated_virtual_amiibos_in_dir_if_changed(super::VIRTUAL_AMIIBO_DIR, manifest.dir_hash, &mut key_set)
+    };
+
+    if new_manifest != manifest {
+        if let Err(rc) = write_compat_manifest(&new_manifest) {
+            log!("Unable to save conversion manifest: {:?}\n", rc);
+        }
+    }
+}
@@ -1,15 +1,19 @@
 use nx::ipc::sf::ncm;
 use nx::result::*;
-use serde::{Serialize, Deserialize};
 use alloc::string::String;
 use alloc::vec::Vec;
 use nx::fs;
+use nx::arm;
 use nx::util;
 use nx::ipc::sf::mii;
 use nx::ipc::sf::nfp;
-use crate::{rc, area, fsext, miiext};
+use crate::{rc, area, fsext, miiext, scratch};
+use super::{meta, SdPlatform};
 
 // Current virtual amiibo format, used since emuiibo v0.5 (with slight modifications)
+// Its files and their loading are in the emuiibo-amiibo crate, this is the virtual amiibo in use (mii charinfo, nfp info, write coalescing...)
+
+pub use emuiibo_amiibo::fmt::{VirtualAmiiboId, VirtualAmiiboDate, VirtualAmiiboInfo, VirtualAmiiboProbeInfo, VirtualAmiiboInfoOptional, VirtualAmiiboAreaEntry, VirtualAmiiboAreaInfo};
 
 #[derive(nx::ipc::sf::Request, nx::ipc::sf::Response, Copy, Clone, PartialEq, Eq, Debug, Default)]
 #[repr(C)]
@@ -28,10 +32,12 @@ pub struct VirtualAmiiboData {
     pub mii_charinfo: mii::CharInfo
 }
 
-// Note: actual amiibo ID in amiibos (nfp services have a different ID type)
+// Minimal data to list a virtual amiibo, see probe_virtual_amiibo
 
-#[derive(Serialize, Deserialize, Clone, Debug)]
-pub struct VirtualAmiiboId {
+#[derive(nx::ipc::sf::Request, nx::ipc::sf::Response, Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct VirtualAmiiboProbeData {
+    pub name: util::ArrayString<41>,
     pub game_character_id: u16,
     pub character_variant: u8,
     pub figure_type: u8,
@@ -39,147 +45,65 @@ pub struct VirtualAmiiboId {
     pub series: u8
 }
 
-impl VirtualAmiiboId {
-    pub const fn empty() -> Self {
-        Self { character_variant: 0, figure_type: 0, game_character_id: 0, model_number: 0, series: 0 }
-    }
-}
-
-#[derive(Serialize, Deserialize, Copy, Clone, Debug)]
-pub struct VirtualAmiiboDate {
-    pub y: u16,
-    pub m: u8,
-    pub d: u8
-}
-
-impl VirtualAmiiboDate {
-    pub const fn from_date(date: nfp::Date) -> Self {
-        Self { y: date.year, m: date.month, d: date.day }
-    }
-
-    pub const fn to_date(&self) -> nfp::Date {
-        nfp::Date { year: self.y, month: self.m, day: self.d }
-    }
-}
-
-#[derive(Serialize, Deserialize, Clone, Debug)]
-pub struct VirtualAmiiboInfo {
-    pub first_write_date: VirtualAmiiboDate,
-    pub id: VirtualAmiiboId,
-    pub last_write_date: VirtualAmiiboDate,
-    pub mii_charinfo_file: String,
-    pub name: String,
-    pub uuid: Vec<u8>,
-    pub use_random_uuid: bool,
-    pub version: u8,
-    pub write_counter: u16
-}
-
-// Note: temporary fix
-
-#[derive(Serialize, Deserialize, Clone, Debug)]
-pub struct VirtualAmiiboInfoOptional {
-    pub first_write_date: VirtualAmiiboDate,
-    pub id: VirtualAmiiboId,
-    pub last_write_date: VirtualAmiiboDate,
-    pub mii_charinfo_file: String,
-    pub name: String,
-    pub uuid: Option<Vec<u8>>,
-    pub use_random_uuid: Option<bool>,
-    pub version: u8,
-    pub write_counter: u16
-}
-
-impl VirtualAmiiboInfoOptional {
-    pub fn convert_to_info(self) -> VirtualAmiiboInfo {
-        VirtualAmiiboInfo {
-            first_write_date: self.first_write_date,
-            id: self.id,
-            last_write_date: self.last_write_date,
-            mii_charinfo_file: self.mii_charinfo_file,
-            name: self.name,
-            uuid: self.uuid.unwrap(),
-            use_random_uuid: self.use_random_uuid.unwrap(),
-            version: self.version,
-            write_counter: self.write_counter
-        }
-    }
-}
-
-#[derive(nx::ipc::sf::Request, nx::ipc::sf::Response, Copy, Clone, Serialize, Deserialize, Debug)]
-#[repr(C)]
-pub struct VirtualAmiiboAreaEntry {
-    pub program_id: u64,
-    pub access_id: nfp::AccessId
-}
-
 // Retail Interactive Display Menu (quite a symbolic ID)
-pub const DEFAULY_EMPTY_AREA_PROGRAM_ID: ncm::ProgramId = ncm::ProgramId(0x0100069000078000);
+pub const DEFAULY_EMPTY_AREA_PROGRAM_ID: ncm::ProgramId = ncm::ProgramId(emuiibo_amiibo::fmt::DEFAULT_EMPTY_AREA_PROGRAM_ID);
 
-#[derive(Serialize, Deserialize, Clone, Debug)]
-pub struct VirtualAmiiboAreaInfo {
-    pub areas: Vec<VirtualAmiiboAreaEntry>,
-    pub current_area_access_id: nfp::AccessId
+#[inline]
+pub const fn to_nfp_date(date: &VirtualAmiiboDate) -> nfp::Date {
+    nfp::Date { year: date.y, month: date.m, day: date.d }
 }
 
-impl VirtualAmiiboAreaInfo {
-    pub const fn empty() -> Self {
-        Self {
-            areas: Vec::new(),
-            current_area_access_id: 0
-        }
-    }
+#[inline]
+pub const fn from_nfp_date(date: nfp::Date) -> VirtualAmiiboDate {
+    VirtualAmiiboDate { y: date.year, m: date.month, d: date.day }
 }
 
-pub fn generate_areas_json(path: String) -> Result<Option<nfp::AccessId>> {
-    let mut access_ids: Vec<nfp::AccessId> = Vec::new();
-
-    let areas_dir = format!("{}/areas", path);
-    log!("Analyzing areas dir: {}\n", areas_dir);
-    if let Ok(mut dir) = fs::open_directory(areas_dir.as_str(), fs::DirectoryOpenMode::ReadFiles()) {
-        loop {
-            if let Ok(Some(entry)) = dir.read_next() {
-                if let Ok(name) = entry.name.get_str() {
-                    // 0x<hex-access-id>.bin
-                    if name.ends_with(".bin") && name.starts_with("0x") && (name.len() == 2 + 8 + 4) {
-                        let hex_access_id_str = &name[2..2 + 8];
-                        if let Ok(access_id) = u32::from_str_radix(hex_access_id_str, 16) {
-                            access_ids.push(access_id);
-                        }
-                    }
-                }
-            }
-            else {
-                break;
-            }
-        }
-    }
+// Unlike try_load, this never writes anything (no areas.json generation, no UUID fixes, no access ID cache updates), so it's suitable for listing directories
+pub fn probe_virtual_amiibo(path: String) -> Result<VirtualAmiiboProbeData> {
+    let scope = scratch::Scope::enter();
+    let amiibo_flag_path = scratch_format!(scope, "{}/amiibo.flag", path);
+    result_return_unless!(fsext::exists_file(amiibo_flag_path), rc::ResultVirtualAmiiboFlagNotFound);
+
+    let amiibo_json_path = scratch_format!(scope, "{}/amiibo.json", path);
+    let probe_info = read_deserialize_json!(amiibo_json_path => VirtualAmiiboProbeInfo)?;
+    result_return_unless!(!probe_info.name.is_empty(), rc::ResultInvalidLoadedVirtualAmiibo);
+
+    let mut data: VirtualAmiiboProbeData = Default::default();
+    data.name.set_str(probe_info.name.as_str())?;
+    data.game_character_id = probe_info.id.game_character_id;
+    data.character_variant = probe_info.id.character_variant;
+    data.figure_type = probe_info.id.figure_type;
+    data.model_number = probe_info.id.model_number;
+    data.series = probe_info.id.series;
+    Ok(data)
+}
 
-    let mut areas = VirtualAmiiboAreaInfo::empty();
-    for access_id in &access_ids {
-        let area_entry = VirtualAmiiboAreaEntry {
-            program_id: DEFAULY_EMPTY_AREA_PROGRAM_ID.0,
-            access_id: *access_id
-        };
-        areas.areas.push(area_entry);
-    }
-    let access_id = access_ids.get(0).map(|id_ref| *id_ref);
-    if let Some(id) = access_id {
-        areas.current_area_access_id = id;
-    }
+// Parts of a virtual amiibo which get saved separately (see VirtualAmiibo::mark_dirty)
+pub const DIRTY_INFO: u8 = 1 << 0; // amiibo.json (and amiibo.flag)
+pub const DIRTY_MII: u8 = 1 << 1; // Mii charinfo file
+pub const DIRTY_AREAS: u8 = 1 << 2; // areas.json
+pub const DIRTY_META: u8 = 1 << 3; // Binary sidecar, see meta.rs
+const DIRTY_JSON: u8 = DIRTY_INFO | DIRTY_MII | DIRTY_AREAS;
 
-    let areas_json_path= format!("{}/areas.json", path);
-    write_serialize_json!(areas_json_path.as_str(), &areas)?;
-
-    Ok(access_id)
-}
+// Consecutive writes get saved together once none happened for this long...
+const WRITE_COALESCE_WINDOW_NS: u64 = 1_000_000_000;
+// ...but pending writes are never delayed longer than this
+const WRITE_MAX_DELAY_NS: u64 = 5_000_000_000;
 
 #[derive(Clone, Debug)]
 pub struct VirtualAmiibo {
     pub info: VirtualAmiiboInfo,
     pub mii_charinfo: mii::CharInfo,
     pub areas: VirtualAmiiboAreaInfo,
-    pub path: String
+    pub path: String,
+    // Binary sidecar state (see meta.rs)
+    uses_meta: bool,
+    meta_area_capacity: usize,
+    meta_json_hash: u64,
+    // Write coalescing state
+    dirty: u8,
+    first_dirty_tick: u64,
+    last_dirty_tick: u64
 }
 
 impl VirtualAmiibo {
@@ -188,7 +112,13 @@ impl VirtualAmiibo {
             info: info,
             mii_charinfo: Default::default(),
             areas: areas,
-            path: path
+            path: path,
+            uses_meta: false,
+            meta_area_capacity: 0,
+            meta_json_hash: 0,
+            dirty: 0,
+            first_dirty_tick: 0,
+            last_dirty_tick: 0
         };
         amiibo.mii_charinfo = amiibo.load_mii_charinfo()?;
         Ok(amiibo)
@@ -275,6 +205,7 @@ impl VirtualAmiibo {
             false => self.areas.areas[0].access_id
         };
 
+        self.mark_dirty(DIRTY_AREAS);
         self.notify_written()
     }
 
@@ -285,6 +216,7 @@ impl VirtualAmiibo {
         self.areas.areas.clear();
         self.areas.current_area_access_id = 0;
 
+        self.mark_dirty(DIRTY_AREAS);
         self.notify_written()
     }
 
@@ -293,19 +225,23 @@ impl VirtualAmiibo {
         
         for area_entry in &mut self.areas.areas {
             if area_entry.access_id == access_id {
-                area_entry.program_id = program_id.0;
+                if area_entry.program_id != program_id.0 {
+                    area_entry.program_id = program_id.0;
+                    self.mark_dirty(DIRTY_AREAS);
+                }
                 break;
             }
         }
 
-        self.save()
+        Ok(())
     }
 
     pub fn set_uuid_info(&mut self, uuid_info: VirtualAmiiboUuidInfo) -> Result<()> {
         self.info.uuid = Vec::from(uuid_info.uuid);
         self.info.use_random_uuid = uuid_info.use_random_uuid;
 
-        self.save()
+        self.mark_dirty(DIRTY_INFO);
+        Ok(())
     }
 
     pub fn produce_data(&self) -> Result<VirtualAmiiboData> {
@@ -316,8 +252,8 @@ impl VirtualAmiibo {
         }
         data.uuid_info.use_random_uuid = self.info.use_random_uuid;
         data.name.set_str(self.info.name.as_str())?;
-        data.first_write_date = self.info.first_write_date.to_date();
-        data.last_write_date = self.info.last_write_date.to_date();
+        data.first_write_date = to_nfp_date(&self.info.first_write_date);
+        data.last_write_date = to_nfp_date(&self.info.last_write_date);
         data.mii_charinfo = self.mii_charinfo;
         Ok(data)
     }
@@ -350,7 +286,7 @@ impl VirtualAmiibo {
     pub fn produce_register_info(&self) -> Result<nfp::RegisterInfo> {
         Ok(nfp::RegisterInfo {
             mii_charinfo: self.mii_charinfo,
-            first_write_date: self.info.first_write_date.to_date(),
+            first_write_date: to_nfp_date(&self.info.first_write_date),
             name: util::ArrayString::from_str(&self.info.name[0..self.info.name.len().min(10)]),
             font_region: 0,
             reserved: [0; 0x7A]
@@ -359,7 +295,7 @@ impl VirtualAmiibo {
 
     pub fn produce_common_info(&self) -> Result<nfp::CommonInfo> {
         Ok(nfp::CommonInfo {
-            last_write_date: self.info.last_write_date.to_date(),
+            last_write_date: to_nfp_date(&self.info.last_write_date),
             write_counter: self.info.write_counter,
             version: self.info.version,
             pad: 0,
@@ -382,7 +318,7 @@ impl VirtualAmiibo {
     pub fn produce_register_info_private(&self) -> Result<nfp::RegisterInfoPrivate> {
         Ok(nfp::RegisterInfoPrivate {
             mii_store_data: mii::StoreData::from_charinfo(self.mii_charinfo)?,
-            first_write_date: self.info.first_write_date.to_date(),
+            first_write_date: to_nfp_date(&self.info.first_write_date),
             name: util::ArrayString::from_str(&self.info.name.clone()[0..self.info.name.len().min(10)]),
             unk: 0,
             reserved: [0; 0x8E]
@@ -426,77 +362,179 @@ impl VirtualAmiibo {
 
     pub fn update_from_register_info_private(&mut self, register_info_private: &nfp::RegisterInfoPrivate) -> Result<()> {
         self.mii_charinfo = register_info_private.mii_store_data.to_charinfo()?;
-        self.info.first_write_date = VirtualAmiiboDate::from_date(register_info_private.first_write_date);
+        self.info.first_write_date = from_nfp_date(register_info_private.first_write_date);
         self.info.name = register_info_private.name.get_string()?;
 
+        self.mark_dirty(DIRTY_MII);
         self.notify_written()
     }
 
-    pub fn save(&self) -> Result<()> {
-        let amiibo_json_path = format!("{}/amiibo.json", self.path);
-        write_serialize_json!(amiibo_json_path.as_str(), &self.info)?;
-
-        let amiibo_flag_path = format!("{}/amiibo.flag", self.path);
-        let _ = fs::create_file(amiibo_flag_path.as_str(), 0, fs::FileAttribute::None());
+    #[inline]
+    fn save_info(&self) -> Result<()> {
+        emuiibo_amiibo::fmt::save_info(&SdPlatform, self.path.as_str(), &self.info)
+    }
 
+    fn save_mii_charinfo(&self) -> Result<()> {
         let mii_charinfo_path = format!("{}/{}", self.path, self.info.mii_charinfo_file);
         let _ = fs::remove_file(mii_charinfo_path.as_str());
         let mut mii_charinfo_file = fs::open_file(mii_charinfo_path.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
         mii_charinfo_file.write_val(&self.mii_charinfo)?;
+        Ok(())
+    }
+
+    #[inline]
+    fn save_areas(&self) -> Result<()> {
+        emuiibo_amiibo::fmt::save_areas(&SdPlatform, self.path.as_str(), &self.areas)
+    }
 
-        let areas_json_path = format!("{}/areas.json", self.path);
-        write_serialize_json!(areas_json_path.as_str(), &self.areas)?;
+    pub fn save(&self) -> Result<()> {
+        self.save_info()?;
+        self.save_mii_charinfo()?;
+        self.save_areas()
+    }
 
+    fn save_parts(&mut self, parts: u8) -> Result<()> {
+        if (parts & DIRTY_INFO) != 0 {
+            self.save_info()?;
+        }
+        if (parts & DIRTY_MII) != 0 {
+            self.save_mii_charinfo()?;
+        }
+        if (parts & DIRTY_AREAS) != 0 {
+            self.save_areas()?;
+        }
+        if self.uses_meta {
+            let json_saved = (parts & (DIRTY_INFO | DIRTY_AREAS)) != 0;
+            if json_saved {
+                // The sidecar must record the JSONs it's now in sync with
+                self.meta_json_hash = meta::hash_json_files(self.path.as_str());
+            }
+            if json_saved || ((parts & DIRTY_META) != 0) {
+                meta::write(self.path.as_str(), &self.info, &self.areas, self.meta_json_hash, &mut self.meta_area_capacity)?;
+            }
+        }
+
+        self.dirty &= !parts;
         Ok(())
     }
 
+    fn save_all(&mut self) -> Result<()> {
+        self.save_parts(DIRTY_JSON | DIRTY_META)
+    }
+
+    // Changes are only saved on the next flush, so that bursts of game writes result in a single save
+    pub fn mark_dirty(&mut self, parts: u8) {
+        let tick = arm::get_system_tick();
+        if self.get_flushable_parts() == 0 {
+            self.first_dirty_tick = tick;
+        }
+        self.last_dirty_tick = tick;
+
+        self.dirty |= parts;
+        if self.uses_meta {
+            self.dirty |= DIRTY_META;
+        }
+    }
+
     pub fn notify_written(&mut self) -> Result<()> {
         if self.info.write_counter < 0xFFFF {
             self.info.write_counter += 1;
         }
-        self.save()
+
+        self.mark_dirty(DIRTY_INFO);
+        Ok(())
     }
-}
 
-impl super::VirtualAmiiboFormat for VirtualAmiibo {
-    fn try_load(path: String) -> Result<Self>  {
-        let amiibo_flag_path = format!("{}/amiibo.flag", path);
-        result_return_unless!(fsext::exists_file(amiibo_flag_path), rc::ResultVirtualAmiiboFlagNotFound);
+    #[inline]
+    fn get_flushable_parts(&self) -> u8 {
+        if self.uses_meta {
+            // Only the sidecar (and the Mii, which it doesn't hold) gets written while in use, the JSONs get exported later (see flush_all)
+            self.dirty & (DIRTY_META | DIRTY_MII)
+        }
+        else {
+            self.dirty
+        }
+    }
 
-        let amiibo_json_path = format!("{}/amiibo.json", path);
-        result_return_unless!(fsext::exists_file(amiibo_json_path.clone()), rc::ResultVirtualAmiiboJsonNotFound);
+    // Saves all pending changes (unmount, finalize...)
+    pub fn flush(&mut self) -> Result<()> {
+        let parts = self.get_flushable_parts();
+        if parts != 0 {
+            self.save_parts(parts)?;
+        }
+        Ok(())
+    }
 
-        let areas_json_path = format!("{}/areas.json", path);
+    // Periodic flush: only saves once writes settle down (or got delayed for too long)
+    pub fn flush_if_due(&mut self) -> Result<()> {
+        if self.get_flushable_parts() != 0 {
+            let tick = arm::get_system_tick();
+            let since_last_ns = arm::ticks_to_nanoseconds(tick - self.last_dirty_tick);
+            let since_first_ns = arm::ticks_to_nanoseconds(tick - self.first_dirty_tick);
+            if (since_last_ns >= WRITE_COALESCE_WINDOW_NS) || (since_first_ns >= WRITE_MAX_DELAY_NS) {
+                self.flush()?;
+            }
+        }
+        Ok(())
+    }
 
-        if !fsext::exists_file(areas_json_path.clone()) {
-            generate_areas_json(path.clone())?;
+    // Saves everything pending, including the JSONs when using the sidecar (the amiibo stops being used)
+    pub fn flush_all(&mut self) -> Result<()> {
+        if self.dirty != 0 {
+            self.save_parts(self.dirty)?;
         }
-        result_return_unless!(fsext::exists_file(areas_json_path.clone()), rc::ResultVirtualAmiiboAreasJsonNotFound);
-
-        let mut needs_save = false;
-
-        let mut amiibo_json_opt = read_deserialize_json!(amiibo_json_path.as_str() => VirtualAmiiboInfoOptional)?;
-        // Fix for those which lack uuids
-        if amiibo_json_opt.uuid.is_none() {
-            let mut uuid = [0u8; 10];
-            super::generate_random_uuid(&mut uuid)?;
-            amiibo_json_opt.uuid = Some(uuid.to_vec());
-            amiibo_json_opt.use_random_uuid = Some(true);
-            needs_save = true;
+        Ok(())
+    }
+
+    fn try_load_from_meta(path: String) -> Result<Self> {
+        let loaded_meta = meta::read(path.as_str())?;
+        // JSONs changed without the sidecar (edited on a PC, saved while it was disabled...) get imported again
+        let json_hash = meta::hash_json_files(path.as_str());
+        result_return_unless!(loaded_meta.json_hash == json_hash, rc::ResultInvalidVirtualAmiiboMeta);
+
+        let (info, areas, area_capacity) = (loaded_meta.info, loaded_meta.areas, loaded_meta.area_capacity);
+        for entry in areas.areas.iter() {
+            area::push_access_id_cache(entry.program_id, entry.access_id)?;
         }
-        if amiibo_json_opt.use_random_uuid.is_none() {
-            amiibo_json_opt.use_random_uuid = Some(false);
-            needs_save = true;
+
+        let mut amiibo = VirtualAmiibo::new(info, areas, path)?;
+        amiibo.uses_meta = true;
+        amiibo.meta_area_capacity = area_capacity;
+        amiibo.meta_json_hash = json_hash;
+        Ok(amiibo)
+    }
+}
+
+impl super::VirtualAmiiboFormat for VirtualAmiibo {
+    fn try_load(path: String) -> Result<Self>  {
+        let scope = scratch::Scope::enter();
+        let amiibo_flag_path = scratch_format!(scope, "{}/amiibo.flag", path);
+        result_return_unless!(fsext::exists_file(amiibo_flag_path), rc::ResultVirtualAmiiboFlagNotFound);
+
+        let uses_meta = meta::is_enabled();
+        if uses_meta && meta::exists(path.as_str()) {
+            match Self::try_load_from_meta(path.clone()) {
+                Ok(amiibo) => return Ok(amiibo),
+                // Fall back to the JSONs, which will recreate the sidecar
+                Err(rc) => log!("Unable to load virtual amiibo sidecar: {:?}\n", rc)
+            }
         }
 
-        let areas_json = read_deserialize_json!(areas_json_path.as_str() => VirtualAmiiboAreaInfo)?;
-        for entry in areas_json.areas.iter() {
+        // Same loading as the PC tools (see the emuiibo-amiibo crate)
+        let loaded_amiibo = emuiibo_amiibo::fmt::load_json(&SdPlatform, path.as_str())?;
+        for entry in loaded_amiibo.areas.areas.iter() {
             area::push_access_id_cache(entry.program_id, entry.access_id)?;
         }
 
-        let amiibo = VirtualAmiibo::new(amiibo_json_opt.convert_to_info(), areas_json, path.clone())?;
-        if needs_save {
-            amiibo.save()?;
+        let mut amiibo = VirtualAmiibo::new(loaded_amiibo.info, loaded_amiibo.areas, path)?;
+        amiibo.uses_meta = uses_meta;
+        if loaded_amiibo.needs_save {
+            amiibo.save_all()?;
+        }
+        else if uses_meta {
+            // Import: create the sidecar from the JSONs
+            amiibo.meta_json_hash = meta::hash_json_files(amiibo.path.as_str());
+            meta::write(amiibo.path.as_str(), &amiibo.info, &amiibo.areas, amiibo.meta_json_hash, &mut amiibo.meta_area_capacity)?;
         }
         Ok(amiibo)
     }
@@ -0,0 +1,40 @@
+use nx::result::*;
+use crate::fsext;
+use super::SdPlatform;
+use super::fmt::{VirtualAmiiboAreaInfo, VirtualAmiiboInfo};
+
+/*
+Optional packed binary sidecar (amiibo-meta.bin) holding everything a game write changes, so it can be saved with a single small write.
+Its layout, reading and writing are in the emuiibo-amiibo crate (shared with the PC tools, see emuiibo-convert's --to-meta/--from-meta).
+
+It's only used when the "meta_sidecar" flag is present.
+*/
+
+pub use emuiibo_amiibo::meta::{META_FILE_NAME, META_MAGIC, META_VERSION, MetaDate, MetaHeader, MetaAreaEntry, LoadedMeta, make_meta_path};
+
+const META_FLAG: &str = "meta_sidecar";
+
+#[inline]
+pub fn is_enabled() -> bool {
+    fsext::has_flag(META_FLAG)
+}
+
+#[inline]
+pub fn exists(amiibo_path: &str) -> bool {
+    fsext::exists_file(make_meta_path(amiibo_path))
+}
+
+#[inline]
+pub fn hash_json_files(amiibo_path: &str) -> u64 {
+    emuiibo_amiibo::meta::hash_json_files(&SdPlatform, amiibo_path)
+}
+
+#[inline]
+pub fn read(amiibo_path: &str) -> Result<LoadedMeta> {
+    emuiibo_amiibo::meta::read(&SdPlatform, amiibo_path)
+}
+
+#[inline]
+pub fn write(amiibo_path: &str, info: &VirtualAmiiboInfo, areas: &VirtualAmiiboAreaInfo, json_hash: u64, area_capacity: &mut usize) -> Result<()> {
+    emuiibo_amiibo::meta::write(&SdPlatform, amiibo_path, info, areas, json_hash, area_capacity)
+}
@@ -3,35 +3,60 @@ use nx::fs;
 use nx::ipc::sf::nfp;
 use alloc::string::String;
 use alloc::vec::Vec;
+use alloc::collections::BTreeMap;
+use nx::sync;
 use serde::{Serialize, Deserialize};
-use crate::{amiibo, fsext};
+use crate::{amiibo, fsext, scratch};
 
 pub struct ApplicationArea {
-    area_file: String
+    area_file: String,
+    // In-memory copy of the area's contents, loaded on first access and kept up to date on writes
+    cached_data: Option<Vec<u8>>,
+    // Whether the cached contents were modified and need to be written back (see flush)
+    modified: bool
 }
 
 impl ApplicationArea {
     pub fn new() -> Self {
-        Self { area_file: String::new() }
+        Self { area_file: String::new(), cached_data: None, modified: false }
     }
 
     pub fn from_id(virtual_amiibo: &amiibo::fmt::VirtualAmiibo, program_id: u64, access_id: nfp::AccessId) -> Self {
-        log!("Saving {:#X} -> {:#X} cache!\n", program_id, access_id);
+        log_debug!("Saving {:#X} -> {:#X} cache!\n", program_id, access_id);
         let rc = push_access_id_cache(program_id, access_id);
-        log!("Cache result: {:?}\n", rc);
+        log_debug!("Cache result: {:?}\n", rc);
         Self::from(virtual_amiibo, access_id)
     }
     
     pub fn from(virtual_amiibo: &amiibo::fmt::VirtualAmiibo, access_id: nfp::AccessId) -> Self {
-        let areas_dir = format!("{}/areas", virtual_amiibo.path);
-        let _ = fs::create_directory(areas_dir.as_str());
-        Self { area_file: format!("{}/0x{:08X}.bin", areas_dir, access_id) }
+        let scope = scratch::Scope::enter();
+        let areas_dir = scratch_format!(scope, "{}/areas", virtual_amiibo.path);
+        let _ = fs::create_directory(areas_dir);
+        let area = Self { area_file: format!("{}/0x{:08X}.bin", areas_dir, access_id), cached_data: None, modified: false };
+        area.recover_interrupted_write();
+        area
+    }
+
+    #[inline]
+    fn make_temp_file(&self) -> String {
+        format!("{}.tmp", self.area_file)
+    }
+
+    // A write interrupted after removing the old area file leaves the (complete) new one as the temp file
+    fn recover_interrupted_write(&self) {
+        let temp_file = self.make_temp_file();
+        if !fsext::exists_file(self.area_file.clone()) && fsext::exists_file(temp_file.clone()) {
+            log!("Recovering interrupted area write: {}\n", self.area_file);
+            let _ = fs::rename_file(temp_file.as_str(), self.area_file.as_str());
+        }
     }
 
     pub fn delete(&mut self) -> Result<()> {
         if self.is_valid() {
             fs::remove_file(self.area_file.as_str())?;
             self.area_file.clear();
+            self.cached_data = None;
+            self.modified = false;
         }
 
         Ok(())
@@ -41,8 +66,16 @@ impl ApplicationArea {
         !self.area_file.is_empty()
     }
 
+    #[inline]
+    pub fn is_same_area(&self, other: &Self) -> bool {
+        self.area_file == other.area_file
+    }
+
     pub fn exists(&self) -> bool {
-        if self.is_valid() {
+        if self.cached_data.is_some() {
+            true
+        }
+        else if self.is_valid() {
             fsext::exists_file(self.area_file.clone())
         }
         else {
@@ -50,30 +83,88 @@ impl ApplicationArea {
         }
     }
 
-    pub unsafe fn create(&self, data: *const u8, data_size: usize, _recreate: bool) -> Result<()> {
+    pub unsafe fn create(&mut self, data: *const u8, data_size: usize, _recreate: bool) -> Result<()> {
         // TODO: difference between create and recreate commands?
         // write already overwrites the area file
         self.write(data, data_size)
     }
 
-    /// SAFETY: `data` must be a valid, non-null pointer
-    pub unsafe fn write(&self, data: *const u8, data_size: usize) -> Result<()> {
+    fn write_file(&self, data: &[u8]) -> Result<()> {
+        // Write the new contents aside first, so that the old area is only replaced by a complete one
+        let temp_file = self.make_temp_file();
+        let _ = fs::remove_file(temp_file.as_str());
+        {
+            let mut file = fs::open_file(temp_file.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+            file.write_array(data)?;
+            file.flush()?;
+        }
+
+        // Renaming doesn't replace existing files
         let _ = fs::remove_file(self.area_file.as_str());
-        let mut file = fs::open_file(self.area_file.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
-        file.write_array(core::slice::from_raw_parts(data,data_size))?;
+        fs::rename_file(temp_file.as_str(), self.area_file.as_str())?;
+        Ok(())
+    }
+
+    /// SAFETY: `data` must be a valid, non-null pointer
+    pub unsafe fn write(&mut self, data: *const u8, data_size: usize) -> Result<()> {
+        let data = core::slice::from_raw_parts(data, data_size);
+        self.write_file(data)?;
+
+        self.cached_data = Some(data.to_vec());
+        self.modified = false;
+        Ok(())
+    }
+
+    /// SAFETY: `data` must be a valid, non-null pointer
+    pub unsafe fn write_cached(&mut self, data: *const u8, data_size: usize) {
+        // Like real tags, the changes are only written back on flush
+        self.cached_data = Some(core::slice::from_raw_parts(data, data_size).to_vec());
+        self.modified = true;
+    }
+
+    #[inline]
+    pub fn has_pending_changes(&self) -> bool {
+        self.modified
+    }
+
+    pub fn flush(&mut self) -> Result<()> {
+        if self.modified {
+            if let Some(cached_data) = self.cached_data.as_ref() {
+                self.write_file(cached_data)?;
+            }
+            self.modified = false;
+        }
+
+        Ok(())
+    }
+
+    #[inline]
+    pub fn load(&mut self) -> Result<()> {
+        self.load_cached_data()?;
         Ok(())
     }
 
+    fn load_cached_data(&mut self) -> Result<&Vec<u8>> {
+        if self.cached_data.is_none() {
+            let mut file = fs::open_file(self.area_file.as_str(), fs::FileOpenOption::Read())?;
+            let mut data: Vec<u8> = vec![0; file.get_size()?];
+            file.read_array(&mut data)?;
+            self.cached_data = Some(data);
+        }
+
+        Ok(self.cached_data.as_ref().unwrap())
+    }
+
     /// SAFETY: `data` must be a valid, non-null pointer
-    pub unsafe fn read(&self, data: *mut u8, data_size: usize) -> Result<()> {
-        let mut file = fs::open_file(self.area_file.as_str(), fs::FileOpenOption::Read())?;
-        file.read_array(core::slice::from_raw_parts_mut(data, data_size))?;
+    pub unsafe fn read(&mut self, data: *mut u8, data_size: usize) -> Result<()> {
+        let cached_data = self.load_cached_data()?;
+        let size = core::cmp::min(data_size, cached_data.len());
+        core::ptr::copy_nonoverlapping(cached_data.as_ptr(), data, size);
         Ok(())
     }
 
-    pub fn get_size(&self) -> Result<usize> {
-        let mut file = fs::open_file(self.area_file.as_str(), fs::FileOpenOption::Read())?;
-        file.get_size()
+    pub fn get_size(&mut self) -> Result<usize> {
+        Ok(self.load_cached_data()?.len())
     }
 }
 
@@ -92,26 +183,54 @@ impl AccessIdCache {
     }
 }
 
+struct AccessIdCacheState {
+    entries: BTreeMap<u64, nfp::AccessId>,
+    dirty: bool
+}
+
+// Resident copy of access_id_cache.json: loaded once at boot, only written back (if dirty) by flush_access_id_cache
+static G_ACCESS_ID_CACHE: sync::Mutex<AccessIdCacheState> = sync::Mutex::new(AccessIdCacheState { entries: BTreeMap::new(), dirty: false });
+
 #[inline(always)]
 pub(crate) fn read_access_id_cache() -> Result<AccessIdCache> {
     read_deserialize_json!(ACCESS_ID_CACHE_PATH => AccessIdCache)
 }
 
-pub fn push_access_id_cache(program_id: u64, access_id: nfp::AccessId) -> Result<()> {
-    let mut cache_json = read_access_id_cache().unwrap_or(AccessIdCache::new());
-
-    let mut found = false;
-    for entry in cache_json.cache.iter_mut() {
-        if entry.program_id == program_id {
-            entry.access_id = access_id;
-            found = true;
-            break;
+pub fn load_access_id_cache() {
+    let mut cache = G_ACCESS_ID_CACHE.lock();
+    cache.entries.clear();
+    cache.dirty = false;
+    if let Ok(cache_json) = read_access_id_cache() {
+        for entry in cache_json.cache.iter() {
+            cache.entries.insert(entry.program_id, entry.access_id);
         }
     }
+    log!("Loaded {} cached access IDs\n", cache.entries.len());
+}
+
+pub fn push_access_id_cache(program_id: u64, access_id: nfp::AccessId) -> Result<()> {
+    let mut cache = G_ACCESS_ID_CACHE.lock();
+    if cache.entries.insert(program_id, access_id) != Some(access_id) {
+        cache.dirty = true;
+    }
+    Ok(())
+}
+
+pub fn lookup_access_id_cache(program_id: u64) -> Option<nfp::AccessId> {
+    G_ACCESS_ID_CACHE.lock().entries.get(&program_id).copied()
+}
 
-    if !found {
-        cache_json.cache.push(amiibo::fmt::VirtualAmiiboAreaEntry { program_id, access_id });
+pub fn flush_access_id_cache() -> Result<()> {
+    let mut cache = G_ACCESS_ID_CACHE.lock();
+    if !cache.dirty {
+        return Ok(());
     }
+
+    let cache_json = AccessIdCache {
+        cache: cache.entries.iter().map(|(&program_id, &access_id)| amiibo::fmt::VirtualAmiiboAreaEntry { program_id, access_id }).collect()
+    };
     write_serialize_json!(ACCESS_ID_CACHE_PATH, &cache_json)?;
+    cache.dirty = false;
+    log!("Flushed {} cached access IDs\n", cache_json.cache.len());
     Ok(())
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 use crate::amiibo;
 use crate::fsext;
+use crate::ipc;
 use alloc::vec::Vec;
 use nx::ipc::sf::ncm;
 use nx::sync;
@@ -53,7 +54,7 @@ pub const IS_DEV_BUILD: bool = true;
 #[cfg(not(debug_assertions))]
 pub const IS_DEV_BUILD: bool = false;
 
-pub const CURRENT_VERSION: Version = Version::from(1, 1, 1, IS_DEV_BUILD);
+pub const CURRENT_VERSION: Version = Version::from(1, 2, 0, IS_DEV_BUILD);
 
 static G_EMULATION_STATUS: AtomicEmulationStatus = AtomicEmulationStatus::new(EmulationStatus::Off);
 static G_ACTIVE_VIRTUAL_AMIIBO_STATUS: AtomicVirtualAmiiboStatus =
@@ -89,6 +90,7 @@ pub fn get_active_virtual_amiibo_status() -> VirtualAmiiboStatus {
 
 pub fn set_active_virtual_amiibo_status(status: VirtualAmiiboStatus) {
     G_ACTIVE_VIRTUAL_AMIIBO_STATUS.store(status, Ordering::SeqCst);
+    ipc::nfp::notify_virtual_amiibo_status(status);
 }
 
 pub fn register_intercepted_application_id(application_id: ncm::ProgramId) {
@@ -112,13 +114,56 @@ pub fn get_active_virtual_amiibo<'a>() -> sync::MutexGuard<'a, Option<amiibo::fm
 }
 
 pub fn set_active_virtual_amiibo(virtual_amiibo: Option<amiibo::fmt::VirtualAmiibo>) {
-    G_ACTIVE_VIRTUAL_AMIIBO_STATUS.store(
-        if virtual_amiibo.is_some() {
-            VirtualAmiiboStatus::Connected
-        } else {
-            VirtualAmiiboStatus::Invalid
-        },
-        Ordering::SeqCst,
-    );
-    *G_ACTIVE_VIRTUAL_AMIIBO.lock() = virtual_amiibo;
+    let status = if virtual_amiibo.is_some() {
+        VirtualAmiiboStatus::Connected
+    } else {
+        VirtualAmiiboStatus::Invalid
+    };
+
+    let mut active_virtual_amiibo = G_ACTIVE_VIRTUAL_AMIIBO.lock();
+    if let Some(old_virtual_amiibo) = active_virtual_amiibo.as_mut() {
+        // Save any pending writes (and the JSONs, if only the binary sidecar was being written)
+        if let Err(rc) = old_virtual_amiibo.flush_all() {
+            log_error!("Unable to save virtual amiibo: {:?}\n", rc);
+        }
+    }
+    *active_virtual_amiibo = virtual_amiibo;
+    drop(active_virtual_amiibo);
+
+    // Only notify handlers once the new amiibo is in place
+    set_active_virtual_amiibo_status(status);
+}
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+pub enum FlushMode {
+    // Periodic flush, only if writes settled down
+    IfDue,
+    // Unmount/finalize
+    Pending,
+    // The amiibo stops being used (application exit...)
+    All
+}
+
+pub fn flush_active_virtual_amiibo(mode: FlushMode) {
+    if let Some(virtual_amiibo) = G_ACTIVE_VIRTUAL_AMIIBO.lock().as_mut() {
+        let rc = match mode {
+            FlushMode::IfDue => virtual_amiibo.flush_if_due(),
+            FlushMode::Pending => virtual_amiibo.flush(),
+            FlushMode::All => virtual_amiibo.flush_all()
+        };
+        if let Err(rc) = rc {
+            log_error!("Unable to save virtual amiibo: {:?}\n", rc);
+        }
+    }
+}
+
+// Called before loading a virtual amiibo from the SD card: if it's the active one, its pending (coalesced) writes would be missing from what gets loaded
+pub fn flush_active_virtual_amiibo_at(path: &str) {
+    if let Some(virtual_amiibo) = G_ACTIVE_VIRTUAL_AMIIBO.lock().as_mut() {
+        if virtual_amiibo.path == path {
+            if let Err(rc) = virtual_amiibo.flush_all() {
+                log_error!("Unable to save virtual amiibo: {:?}\n", rc);
+            }
+        }
+    }
 }
@@ -2,7 +2,7 @@ use alloc::string::ToString;
 use nx::result::*;
 use nx::fs;
 use alloc::string::String;
-use crate::{amiibo, miiext};
+use crate::{amiibo, miiext, scratch};
 
 #[inline]
 pub fn exists_file(path: impl AsRef<str>) -> bool {
@@ -22,7 +22,8 @@ pub fn make_flag_path(name: &str) -> String {
 }
 
 pub fn has_flag(name: &str) -> bool {
-    exists_file(make_flag_path(name))
+    let scope = scratch::Scope::enter();
+    exists_file(scratch_format!(scope, "{}/{}.flag", FLAGS_DIR, name))
 }
 
 pub fn set_flag(name: &str, enabled: bool) {
@@ -96,7 +97,8 @@ pub fn ensure_directories() -> Result<()> {
     let _ = fs::create_directory(BASE_DIR);
     let _ = fs::create_directory(amiibo::VIRTUAL_AMIIBO_DIR);
     let _ = fs::create_directory(FLAGS_DIR);
-    recreate_directory(miiext::EXPORTED_MIIS_DIR)?;
+    // Not recreated: miis get exported incrementally (see miiext::export_miis)
+    let _ = fs::create_directory(miiext::EXPORTED_MIIS_DIR);
 
     Ok(())
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+use alloc::string::String;
+use nx::result::*;
+use nx::thread;
+use crate::area;
+use crate::emu;
+use crate::logger;
+use crate::miiext;
+use crate::trace;
+
+// Deferred writes (access ID cache, active virtual amiibo, NFP trace, logs...) are coalesced and checked once per interval
+const FLUSH_INTERVAL_NS: i64 = 1_000_000_000;
+
+fn flush_access_id_cache() {
+    if let Err(rc) = area::flush_access_id_cache() {
+        log_error!("Error flushing access ID cache: {:?}\n", rc);
+    }
+}
+
+fn dump_trace() {
+    if let Err(rc) = trace::dump() {
+        log_error!("Error dumping NFP trace: {:?}\n", rc);
+    }
+}
+
+// Saves everything right away, for when the application is exiting
+pub fn flush_deferred_writes() {
+    emu::flush_active_virtual_amiibo(emu::FlushMode::All);
+    flush_access_id_cache();
+    dump_trace();
+    logger::flush();
+}
+
+fn housekeeping_thread_fn() {
+    // Done here instead of at boot, so that our services don't wait on it
+    if let Err(rc) = miiext::export_miis() {
+        log_error!("Error exporting miis: {:?}\n", rc);
+    }
+
+    loop {
+        let _ = thread::sleep(FLUSH_INTERVAL_NS);
+        emu::flush_active_virtual_amiibo(emu::FlushMode::IfDue);
+        flush_access_id_cache();
+        dump_trace();
+        logger::flush();
+    }
+}
+
+pub fn initialize() -> Result<()> {
+    let handle = thread::Builder::new().core(thread::ThreadStartCore::Default).priority(thread::ThreadPriority::Set(0x3B)).name(String::from("emuiibo.Housekeeping")).stack_size(0x2000).spawn(move || {
+        housekeeping_thread_fn();
+    })?;
+
+    // The thread runs for the whole sysmodule's lifetime, it's never joined
+    core::mem::forget(handle);
+    Ok(())
+}
@@ -10,6 +10,8 @@ use nx::version;
 use crate::rc;
 use crate::emu;
 use crate::amiibo;
+use crate::area;
+use crate::scratch;
 use crate::amiibo::VirtualAmiiboFormat;
 
 ipc_sf_define_default_client_for_interface!(EmulationService);
@@ -30,6 +32,11 @@ ipc_sf_define_interface_trait! {
         get_active_virtual_amiibo_current_area [12, version::VersionInterval::all()]: () => (access_id: nfp::AccessId) (access_id: nfp::AccessId);
         set_active_virtual_amiibo_current_area [13, version::VersionInterval::all()]: (access_id: nfp::AccessId) => () ();
         set_active_virtual_amiibo_uuid_info [14, version::VersionInterval::all()]: (uuid_info: amiibo::fmt::VirtualAmiiboUuidInfo) => () ();
+        get_active_virtual_amiibo_area_count [15, version::VersionInterval::all()]: () => (count: u32) (count: u32);
+        get_active_virtual_amiibo_areas_from [16, version::VersionInterval::all()]: (offset: u32, out_areas: sf::OutMapAliasBuffer<amiibo::fmt::VirtualAmiiboAreaEntry>) => (count: u32) (count: u32);
+        probe_virtual_amiibo [17, version::VersionInterval::all()]: (path: sf::InMapAliasBuffer<u8>) => (probe_data: amiibo::fmt::VirtualAmiiboProbeData) (probe_data: amiibo::fmt::VirtualAmiiboProbeData);
+        get_cached_access_id [18, version::VersionInterval::all()]: (program_id: ncm::ProgramId) => (access_id: nfp::AccessId) (access_id: nfp::AccessId);
+        get_scratch_stats [19, version::VersionInterval::all()]: () => (stats: scratch::ScratchStats) (stats: scratch::ScratchStats);
     }
 }
 
@@ -74,6 +81,7 @@ impl IEmulationServiceServer for EmulationServer {
     fn set_active_virtual_amiibo(&mut self, path: sf::InMapAliasBuffer<u8>) -> Result<()> {
         let path_str = path.get_string();
         log!("SetActiveVirtualAmiibo -- path: '{}'\n", path_str);
+        emu::flush_active_virtual_amiibo_at(path_str.as_str());
         let amiibo = amiibo::fmt::VirtualAmiibo::try_load(path_str)?;
         result_return_unless!(amiibo.is_valid(), rc::ResultInvalidLoadedVirtualAmiibo);
 
@@ -107,6 +115,7 @@ impl IEmulationServiceServer for EmulationServer {
     fn try_parse_virtual_amiibo(&mut self, path: sf::InMapAliasBuffer<u8>) -> Result<amiibo::fmt::VirtualAmiiboData> {
         let path_str = path.get_string();
         log!("TryParseVirtualAmiibo -- path: '{}'\n", path_str);
+        emu::flush_active_virtual_amiibo_at(path_str.as_str());
         let amiibo = amiibo::fmt::VirtualAmiibo::try_load(path_str)?;
         result_return_unless!(amiibo.is_valid(), rc::ResultInvalidLoadedVirtualAmiibo);
 
@@ -162,11 +171,57 @@ impl IEmulationServiceServer for EmulationServer {
 
         amiibo.as_mut().unwrap().set_uuid_info(uuid_info)
     }
+
+    fn get_active_virtual_amiibo_area_count(&mut self) -> Result<u32> {
+        log!("GetActiveVirtualAmiiboAreaCount -- (...)\n");
+        let amiibo = emu::get_active_virtual_amiibo();
+        result_return_unless!(amiibo.is_some(), rc::ResultInvalidActiveVirtualAmiibo);
+
+        Ok(amiibo.as_ref().unwrap().areas.areas.len() as u32)
+    }
+
+    fn get_active_virtual_amiibo_areas_from(&mut self, offset: u32, mut out_areas: sf::OutMapAliasBuffer<amiibo::fmt::VirtualAmiiboAreaEntry>) -> Result<u32> {
+        log!("GetActiveVirtualAmiiboAreasFrom -- offset: {}\n", offset);
+        let amiibo = emu::get_active_virtual_amiibo();
+        result_return_unless!(amiibo.is_some(), rc::ResultInvalidActiveVirtualAmiibo);
+
+        let amiibo = amiibo.as_ref().unwrap();
+
+        // Paged variant of get_active_virtual_amiibo_areas, so that callers aren't limited by a single buffer's size
+        let src_areas = amiibo.areas.areas.get(offset as usize..).unwrap_or(&[]);
+        let areas = out_areas.as_slice_mut()?;
+
+        let count = areas.len().min(src_areas.len());
+        areas[..count].copy_from_slice(&src_areas[..count]);
+
+        Ok(count as u32)
+    }
+
+    fn probe_virtual_amiibo(&mut self, path: sf::InMapAliasBuffer<u8>) -> Result<amiibo::fmt::VirtualAmiiboProbeData> {
+        let path_str = path.get_string();
+        log!("ProbeVirtualAmiibo -- path: '{}'\n", path_str);
+        emu::flush_active_virtual_amiibo_at(path_str.as_str());
+        amiibo::fmt::probe_virtual_amiibo(path_str)
+    }
+
+    fn get_cached_access_id(&mut self, program_id: ncm::ProgramId) -> Result<nfp::AccessId> {
+        log!("GetCachedAccessId -- program_id: {:#X}\n", program_id.0);
+        area::lookup_access_id_cache(program_id.0).ok_or(rc::ResultAccessIdNotCached::make())
+    }
+
+    // Debug command: scratch arena usage, for tuning the arena/heap sizes
+    fn get_scratch_stats(&mut self) -> Result<scratch::ScratchStats> {
+        let stats = scratch::get_stats();
+        log!("GetScratchStats -- arena_size: {:#X}, arena_high_water_mark: {:#X}, heap_fallback_count: {}\n", stats.arena_size, stats.arena_high_water_mark, stats.heap_fallback_count);
+        Ok(stats)
+    }
 }
 
 impl server::ISessionObject for EmulationServer {
     fn try_handle_request_by_id(&mut self, req_id: u32, protocol: nx::ipc::CommandProtocol, server_ctx: &mut server::ServerContext) -> Option<Result<()>> {
-        <Self as IEmulationServiceServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx)
+        let rc = <Self as IEmulationServiceServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx);
+        scratch::reset_after_dispatch();
+        rc
     }
 }
 
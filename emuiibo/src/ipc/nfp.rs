@@ -7,9 +7,11 @@ use nx::wait;
 use nx::sync;
 use nx::service::hid;
 use nx::input;
-use nx::thread;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
 use crate::area;
 use crate::emu;
+use crate::housekeeping;
 
 static G_INPUT_CTX: generic_once_cell::OnceCell<sync::sys::mutex::Mutex,input::Context> = generic_once_cell::OnceCell::new();
 
@@ -25,11 +27,32 @@ pub fn get_input_context() -> &'static input::Context {
     G_INPUT_CTX.get().unwrap()
 }
 
+// Emulation states of all initialized handlers, which get virtual amiibo status changes pushed to them (see notify_virtual_amiibo_status)
+static G_EMULATION_STATES: sync::Mutex<Vec<(u64, Shared<EmulationState>)>> = sync::Mutex::new(Vec::new());
+static G_NEXT_HANDLER_ID: AtomicU64 = AtomicU64::new(0);
+
+fn register_emulation_state(handler_id: u64, emulation_state: Shared<EmulationState>) {
+    let mut emulation_states = G_EMULATION_STATES.lock();
+    if !emulation_states.iter().any(|(id, _)| *id == handler_id) {
+        emulation_states.push((handler_id, emulation_state));
+    }
+}
+
+fn unregister_emulation_state(handler_id: u64) {
+    G_EMULATION_STATES.lock().retain(|(id, _)| *id != handler_id);
+}
+
+pub fn notify_virtual_amiibo_status(status: emu::VirtualAmiiboStatus) {
+    for (_, emulation_state) in G_EMULATION_STATES.lock().iter() {
+        emulation_state.lock().handle_virtual_amiibo_status(status);
+    }
+}
+
 pub struct EmulationHandler {
     application_id: ncm::ProgramId,
+    handler_id: u64,
     emulation_state: Shared<EmulationState>,
-    current_opened_area: area::ApplicationArea,
-    emu_handler_thread: Option<thread::JoinHandle<()>>
+    current_opened_area: area::ApplicationArea
 }
 
 pub struct EmulationState {
@@ -37,13 +60,12 @@ pub struct EmulationState {
     deactivate_event: wait::SystemEvent,
     availability_change_event: wait::SystemEvent,
     state: nfp::State,
-    device_state: nfp::DeviceState,
-    should_end_thread: bool,
+    device_state: nfp::DeviceState
 }
 
 impl EmulationState {
     pub fn new() -> Result<Self> {
-        Ok(Self { activate_event: wait::SystemEvent::new()?, deactivate_event: wait::SystemEvent::new()?, availability_change_event: wait::SystemEvent::new()?, state: nfp::State::NonInitialized, device_state: nfp::DeviceState::Unavailable, should_end_thread: false })
+        Ok(Self { activate_event: wait::SystemEvent::new()?, deactivate_event: wait::SystemEvent::new()?, availability_change_event: wait::SystemEvent::new()?, state: nfp::State::NonInitialized, device_state: nfp::DeviceState::Unavailable })
     }
 
     fn handle_virtual_amiibo_status(&mut self, status: emu::VirtualAmiiboStatus) {
@@ -71,7 +93,7 @@ impl EmulationHandler {
     pub fn new(application_id: ncm::ProgramId) -> Result<Self> {
         log!("\n[{:#X}] New handler!\n", application_id.0);
         
-        Ok(Self { application_id, emulation_state: Shared::new(EmulationState::new()?), emu_handler_thread: None, current_opened_area: area::ApplicationArea::new() })
+        Ok(Self { application_id, handler_id: G_NEXT_HANDLER_ID.fetch_add(1, Ordering::SeqCst), emulation_state: Shared::new(EmulationState::new()?), current_opened_area: area::ApplicationArea::new() })
     }
 
     #[inline]
@@ -87,30 +109,13 @@ impl EmulationHandler {
         self.emulation_state.lock().device_state == device_state
     }
 
-    fn emu_handler_thread_fn(handler: Shared<EmulationState>) {
-        loop {
-            {
-                let handle_handle = handler.lock();
-                if handle_handle.should_end_thread == true {
-                    return;
-                }
-            }
-            
-            let mut handle_handle = handler.lock();
-            let status = emu::get_active_virtual_amiibo_status();
-            handle_handle.handle_virtual_amiibo_status(status);
-            let _ = thread::sleep(100_000_000);
-        }
-
-    }
-
     pub fn initialize(&mut self, aruid: sf::AppletResourceUserId, mcu_data: sf::InMapAliasBuffer<nfp::McuVersionData>) -> Result<()> {
         // TODO: make use of aruid or mcu data?
         result_return_unless!(self.is_state(nfp::State::NonInitialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] Initialize -- aruid: {}, process_id: {}, mcu_version_data: (count: {})\n", self.application_id.0, aruid.aruid, aruid.process_id, mcu_data.get_count());
+        log_debug!("[{:#X}] Initialize -- aruid: {}, process_id: {}, mcu_version_data: (count: {})\n", self.application_id.0, aruid.aruid, aruid.process_id, mcu_data.get_count());
         let mcu_ver_datas = mcu_data.get_maybe_unaligned();
         for mcu_ver_data in mcu_ver_datas {
-            log!("[{:#X}] Initialize -- mcu version: {}\n", self.application_id.0, mcu_ver_data.version);
+            log_debug!("[{:#X}] Initialize -- mcu version: {}\n", self.application_id.0, mcu_ver_data.version);
         }
 
         {
@@ -119,18 +124,16 @@ impl EmulationHandler {
             emulation_state_handle.device_state = nfp::DeviceState::Initialized;
         }
 
-        // TODO: different thread names depending on the app id?
-        let thread_name = format!("emuWoker:{:X?}", self.application_id.0);
-        let handle = self.emulation_state.clone();
-        self.emu_handler_thread = Some(thread::Builder::new().core(thread::ThreadStartCore::Default).priority(thread::ThreadPriority::Set(0x2B)).name(thread_name).stack_size(0x1000).spawn(move || {
-            Self::emu_handler_thread_fn(handle);
-        })?);
+        // Status changes get pushed from now on, no need for a worker thread polling them
+        register_emulation_state(self.handler_id, self.emulation_state.clone());
         Ok(())
     }
 
     pub fn finalize(&mut self) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] Finalize -- (...)\n", self.application_id.0);
+        log_debug!("[{:#X}] Finalize -- (...)\n", self.application_id.0);
+
+        emu::flush_active_virtual_amiibo(emu::FlushMode::Pending);
 
         let mut emulation_state_handle = self.emulation_state.lock();
         emulation_state_handle.state = nfp::State::NonInitialized;
@@ -140,7 +143,7 @@ impl EmulationHandler {
 
     pub fn list_devices(&mut self, mut out_devices: sf::OutPointerBuffer<nfp::DeviceHandle>) -> Result<u32> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] ListDevices -- out_devices: (count: {})\n", self.application_id.0, out_devices.get_count());
+        log_debug!("[{:#X}] ListDevices -- out_devices: (count: {})\n", self.application_id.0, out_devices.get_count());
 
         // Note: a DeviceHandle's id != npad_id on official nfp, but we treat them as the same thing since we don't care about it
         // Official nfp would store the npad_id somewhere else for the command below which retrieves it
@@ -167,15 +170,18 @@ impl EmulationHandler {
     pub fn start_detection(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::Initialized) || self.is_device_state(nfp::DeviceState::TagRemoved), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] StartDetection -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] StartDetection -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
-        self.emulation_state.lock().device_state = nfp::DeviceState::SearchingForTag;
+        let mut emulation_state_handle = self.emulation_state.lock();
+        emulation_state_handle.device_state = nfp::DeviceState::SearchingForTag;
+        // The virtual amiibo might already be connected
+        emulation_state_handle.handle_virtual_amiibo_status(emu::get_active_virtual_amiibo_status());
         Ok(())
     }
 
     pub fn stop_detection(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] StopDetection -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] StopDetection -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         self.emulation_state.lock().device_state = nfp::DeviceState::Initialized;
         Ok(())
@@ -183,7 +189,7 @@ impl EmulationHandler {
 
     pub fn mount(&mut self, device_handle: nfp::DeviceHandle, model_type: nfp::ModelType, mount_target: nfp::MountTarget) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] Mount -- device_handle: (fake id: {}), model_type: {:?}, mount_target: {:?}\n", self.application_id.0, device_handle.id, model_type, mount_target);
+        log_debug!("[{:#X}] Mount -- device_handle: (fake id: {}), model_type: {:?}, mount_target: {:?}\n", self.application_id.0, device_handle.id, model_type, mount_target);
         
         self.emulation_state.lock().device_state = nfp::DeviceState::TagMounted;
         Ok(())
@@ -191,8 +197,9 @@ impl EmulationHandler {
 
     pub fn unmount(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] Unmount -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] Unmount -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
         
+        emu::flush_active_virtual_amiibo(emu::FlushMode::Pending);
         self.emulation_state.lock().device_state = nfp::DeviceState::TagFound;
         Ok(())
     }
@@ -200,12 +207,14 @@ impl EmulationHandler {
     pub fn open_application_area(&mut self, device_handle: nfp::DeviceHandle, access_id: nfp::AccessId) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] OpenApplicationArea -- device_handle: (fake id: {}), access_id: {:#X}\n", self.application_id.0, device_handle.id, access_id);
+        log_debug!("[{:#X}] OpenApplicationArea -- device_handle: (fake id: {}), access_id: {:#X}\n", self.application_id.0, device_handle.id, access_id);
 
         match emu::get_active_virtual_amiibo().as_mut() {
             Some(amiibo) => {
-                let application_area = area::ApplicationArea::from_id(&amiibo, self.application_id.0, access_id);
+                let mut application_area = area::ApplicationArea::from_id(&amiibo, self.application_id.0, access_id);
                 result_return_unless!(application_area.exists(), nfp::rc::ResultAreaNeedsToBeCreated);
+                // Further get/set commands are served from memory until the area gets flushed
+                application_area.load()?;
 
                 amiibo.update_area_program_id(access_id, self.application_id)?;
                 self.current_opened_area = application_area;
@@ -221,7 +230,7 @@ impl EmulationHandler {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.current_opened_area.exists(), nfp::rc::ResultAreaNeedsToBeCreated);
-        log!("[{:#X}] GetApplicationArea -- device_handle: (fake id: {}), out_data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, out_data.get_size());
+        log_debug!("[{:#X}] GetApplicationArea -- device_handle: (fake id: {}), out_data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, out_data.get_size());
 
         let area_size = self.current_opened_area.get_size()?;
         let size = core::cmp::min(area_size, out_data.get_size());
@@ -235,29 +244,32 @@ impl EmulationHandler {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.current_opened_area.exists(), nfp::rc::ResultAreaNeedsToBeCreated);
-        log!("[{:#X}] SetApplicationArea -- device_handle: (fake id: {}), data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, data.get_size());
+        log_debug!("[{:#X}] SetApplicationArea -- device_handle: (fake id: {}), data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, data.get_size());
 
         let area_size = self.current_opened_area.get_size()?;
         let size = core::cmp::min(area_size, data.get_size());
 
         // TODO check the pointer for nulls and return appropriate error code
-        unsafe {self.current_opened_area.write(data.get_address(), size)?;}
-        if let Some(amiibo)  = emu::get_active_virtual_amiibo().as_mut() {
-            amiibo.notify_written()?;
-        }
+        unsafe {self.current_opened_area.write_cached(data.get_address(), size);}
         Ok(())
     }
 
     pub fn flush(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] Flush -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] Flush -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
+        if self.current_opened_area.has_pending_changes() {
+            self.current_opened_area.flush()?;
+            if let Some(amiibo) = emu::get_active_virtual_amiibo().as_mut() {
+                amiibo.notify_written()?;
+            }
+        }
         Ok(())
     }
 
     pub fn restore(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] Restore -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] Restore -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         Ok(())
     }
@@ -265,14 +277,17 @@ impl EmulationHandler {
     pub fn create_application_area(&mut self, device_handle: nfp::DeviceHandle, access_id: nfp::AccessId, data: sf::InMapAliasBuffer<u8>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] CreateApplicationArea -- device_handle: (fake id: {}), access_id: {:#X}, data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, access_id, data.get_size());
+        log_debug!("[{:#X}] CreateApplicationArea -- device_handle: (fake id: {}), access_id: {:#X}, data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, access_id, data.get_size());
 
         match emu::get_active_virtual_amiibo().as_mut() {
             Some(amiibo) => {
-                let application_area = area::ApplicationArea::from_id(&amiibo, self.application_id.0, access_id);
+                let mut application_area = area::ApplicationArea::from_id(&amiibo, self.application_id.0, access_id);
                 result_return_if!(application_area.exists(), nfp::rc::ResultAreaNeedsToBeCreated);
                 // TODO check the pointer for nulls and return appropriate error code
                 unsafe { application_area.create(data.get_address(), data.get_size(), false)?; }
+                if self.current_opened_area.is_same_area(&application_area) {
+                    self.current_opened_area = application_area;
+                }
                 amiibo.notify_written()
             },
             None => {
@@ -284,7 +299,7 @@ impl EmulationHandler {
     pub fn get_tag_info(&mut self, device_handle: nfp::DeviceHandle, mut out_tag_info: sf::OutFixedPointerBuffer<nfp::TagInfo>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagFound) || self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetTagInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetTagInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -300,7 +315,7 @@ impl EmulationHandler {
     pub fn get_register_info(&mut self, device_handle: nfp::DeviceHandle, mut out_register_info: sf::OutFixedPointerBuffer<nfp::RegisterInfo>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetRegisterInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetRegisterInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -316,7 +331,7 @@ impl EmulationHandler {
     pub fn get_common_info(&mut self, device_handle: nfp::DeviceHandle, mut out_common_info: sf::OutFixedPointerBuffer<nfp::CommonInfo>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetCommonInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetCommonInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -332,7 +347,7 @@ impl EmulationHandler {
     pub fn get_model_info(&mut self, device_handle: nfp::DeviceHandle, mut out_model_info: sf::OutFixedPointerBuffer<nfp::ModelInfo>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetModelInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetModelInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -347,31 +362,31 @@ impl EmulationHandler {
 
     pub fn attach_activate_event(&mut self, device_handle: nfp::DeviceHandle) -> Result<sf::CopyHandle> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] AttachActivateEvent -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] AttachActivateEvent -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         Ok(sf::Handle::from(self.emulation_state.lock().activate_event.client_handle))
     }
 
     pub fn attach_deactivate_event(&mut self, device_handle: nfp::DeviceHandle) -> Result<sf::CopyHandle> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] AttachDeactivateEvent -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] AttachDeactivateEvent -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         Ok(sf::Handle::from(self.emulation_state.lock().deactivate_event.client_handle))
     }
 
     pub fn get_state(&mut self) -> Result<nfp::State> {
-        log!("[{:#X}] GetState -- (...)\n", self.application_id.0);
+        log_debug!("[{:#X}] GetState -- (...)\n", self.application_id.0);
         Ok(self.emulation_state.lock().state)
     }
 
     pub fn get_device_state(&mut self, device_handle: nfp::DeviceHandle) -> Result<nfp::DeviceState> {
-        log!("[{:#X}] GetDeviceState -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetDeviceState -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
         Ok(self.emulation_state.lock().device_state)
     }
 
     pub fn get_npad_id(&mut self, device_handle: nfp::DeviceHandle) -> Result<hid::NpadIdType> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetNpadId -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetNpadId -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
         
         Ok(unsafe { core::mem::transmute(device_handle.id) })
     }
@@ -380,7 +395,7 @@ impl EmulationHandler {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.current_opened_area.exists(), nfp::rc::ResultAreaNeedsToBeCreated);
-        log!("[{:#X}] GetApplicationAreaSize -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetApplicationAreaSize -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         let area_size = self.current_opened_area.get_size()?;
         Ok(area_size as u32)
@@ -388,7 +403,7 @@ impl EmulationHandler {
 
     pub fn attach_availability_change_event(&mut self) -> Result<sf::CopyHandle> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] AttachAvailabilityChangeEvent -- (...)\n", self.application_id.0);
+        log_debug!("[{:#X}] AttachAvailabilityChangeEvent -- (...)\n", self.application_id.0);
 
         Ok(sf::Handle::from(self.emulation_state.lock().availability_change_event.client_handle))
     }
@@ -396,13 +411,17 @@ impl EmulationHandler {
     pub fn recreate_application_area(&mut self, device_handle: nfp::DeviceHandle, access_id: nfp::AccessId, data: sf::InMapAliasBuffer<u8>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] RecreateApplicationArea -- device_handle: (fake id: {}), access_id: {:#X}, data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, access_id, data.get_size());
+        log_debug!("[{:#X}] RecreateApplicationArea -- device_handle: (fake id: {}), access_id: {:#X}, data: (buf_size: {:#X})\n", self.application_id.0, device_handle.id, access_id, data.get_size());
 
         match emu::get_active_virtual_amiibo().as_mut() {
             Some(amiibo) => {
-                let application_area = area::ApplicationArea::from_id(&amiibo, self.application_id.0, access_id);
+                let mut application_area = area::ApplicationArea::from_id(&amiibo, self.application_id.0, access_id);
                 // TODO check the pointer for nulls and return appropriate error code
                 unsafe {application_area.create(data.get_address(), data.get_size(), true)?; }
+                // Don't keep serving the old contents from the opened area's cache
+                if self.current_opened_area.is_same_area(&application_area) {
+                    self.current_opened_area = application_area;
+                }
                 amiibo.notify_written()
             },
             None => {
@@ -412,7 +431,7 @@ impl EmulationHandler {
     }
 
     pub fn format(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
-        log!("[{:#X}] Format -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] Format -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         Ok(())
     }
@@ -420,7 +439,7 @@ impl EmulationHandler {
     pub fn get_admin_info(&mut self, device_handle: nfp::DeviceHandle, mut out_admin_info: sf::OutFixedPointerBuffer<nfp::AdminInfo>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetAdminInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetAdminInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
         
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -437,7 +456,7 @@ impl EmulationHandler {
     pub fn get_register_info_private(&mut self, device_handle: nfp::DeviceHandle, mut out_register_info_private: sf::OutFixedPointerBuffer<nfp::RegisterInfoPrivate>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] GetRegisterInfoPrivate -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] GetRegisterInfoPrivate -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -454,7 +473,7 @@ impl EmulationHandler {
     pub fn set_register_info_private(&mut self, device_handle: nfp::DeviceHandle, register_info_private: sf::InFixedPointerBuffer<nfp::RegisterInfoPrivate>) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] SetRegisterInfoPrivate -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] SetRegisterInfoPrivate -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_mut() {
             Some(amiibo) => {
@@ -471,11 +490,12 @@ impl EmulationHandler {
     pub fn delete_register_info(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] DeleteRegisterInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] DeleteRegisterInfo -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_mut() {
             Some(amiibo) => {
                 amiibo.delete_all_areas()?;
+                self.current_opened_area = area::ApplicationArea::new();
             },
             None => {
                 return Err(nfp::rc::ResultDeviceNotFound::make());
@@ -487,11 +507,12 @@ impl EmulationHandler {
     pub fn delete_application_area(&mut self, device_handle: nfp::DeviceHandle) -> Result<()> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] DeleteApplicationArea -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] DeleteApplicationArea -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_mut() {
             Some(amiibo) => {
                 amiibo.delete_current_area()?;
+                self.current_opened_area = area::ApplicationArea::new();
             },
             None => {
                 return Err(nfp::rc::ResultDeviceNotFound::make());
@@ -504,7 +525,7 @@ impl EmulationHandler {
     pub fn exists_application_area(&mut self, device_handle: nfp::DeviceHandle) -> Result<bool> {
         result_return_unless!(self.is_state(nfp::State::Initialized), nfp::rc::ResultDeviceNotFound);
         result_return_unless!(self.is_device_state(nfp::DeviceState::TagMounted), nfp::rc::ResultDeviceNotFound);
-        log!("[{:#X}] ExistsApplicationArea -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
+        log_debug!("[{:#X}] ExistsApplicationArea -- device_handle: (fake id: {})\n", self.application_id.0, device_handle.id);
 
         match emu::get_active_virtual_amiibo().as_ref() {
             Some(amiibo) => {
@@ -520,10 +541,10 @@ impl EmulationHandler {
 impl Drop for EmulationHandler {
     fn drop(&mut self) {
         log!("[{:#X}] Dropping handler...\n", self.application_id.0);
-        self.emulation_state.lock().should_end_thread = true;
-        if let Some(thread_handle) = self.emu_handler_thread.take() {
-            thread_handle.join().expect("We shouldn't expect any of the threads to panic. There isn't anything very interesting happening");
-        }
+        unregister_emulation_state(self.handler_id);
+
+        // The application is exiting, don't wait for the next periodic flush
+        housekeeping::flush_deferred_writes();
     }
 }
 
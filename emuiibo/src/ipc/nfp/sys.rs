@@ -9,6 +9,8 @@ use nx::ipc::sf::nfp::ISystemManagerServer;
 use nx::ipc::sf::sm;
 
 use crate::emu;
+use crate::scratch;
+use crate::trace;
 use super::EmulationHandler;
 
 pub struct SystemEmulator {
@@ -131,7 +133,11 @@ impl ISystemServer for SystemEmulator {
 
 impl server::ISessionObject for SystemEmulator {
     fn try_handle_request_by_id(&mut self, req_id: u32, protocol: nx::ipc::CommandProtocol, server_ctx: &mut nx::ipc::server::ServerContext) -> Option<Result<()>> {
-        <Self as ISystemServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx)
+        let start_tick = trace::begin();
+        let rc = <Self as ISystemServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx);
+        trace::record(trace::TraceInterface::System, req_id, self.handler.get_application_id().0, start_tick, &rc);
+        scratch::reset_after_dispatch();
+        rc
     }
 }
 
@@ -141,7 +147,9 @@ pub struct SystemManager {
 
 impl server::ISessionObject for SystemManager {
     fn try_handle_request_by_id(&mut self, req_id: u32, protocol: nx::ipc::CommandProtocol, server_ctx: &mut server::ServerContext) -> Option<Result<()>> {
-        <Self as ISystemManagerServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx)
+        let rc = <Self as ISystemManagerServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx);
+        scratch::reset_after_dispatch();
+        rc
     }
 }
 
@@ -11,6 +11,8 @@ use nx::ipc::sf::nfp::IUserManagerServer;
 use nx::ipc::sf::sm;
 
 use crate::emu;
+use crate::scratch;
+use crate::trace;
 use super::EmulationHandler;
 
 pub struct UserEmulator {
@@ -141,7 +143,11 @@ impl IUserServer for UserEmulator {
 
 impl server::ISessionObject for UserEmulator {
     fn try_handle_request_by_id(&mut self, req_id: u32, protocol: nx::ipc::CommandProtocol, server_ctx: &mut server::ServerContext) -> Option<Result<()>> {
-        <Self as IUserServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx)
+        let start_tick = trace::begin();
+        let rc = <Self as IUserServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx);
+        trace::record(trace::TraceInterface::User, req_id, self.handler.get_application_id().0, start_tick, &rc);
+        scratch::reset_after_dispatch();
+        rc
     }
 }
 
@@ -158,7 +164,9 @@ impl IUserManagerServer for UserManager {
 
 impl server::ISessionObject for UserManager {
     fn try_handle_request_by_id(&mut self, req_id: u32, protocol: nx::ipc::CommandProtocol, server_ctx: &mut server::ServerContext) -> Option<Result<()>> {
-        <Self as IUserManagerServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx)
+        let rc = <Self as IUserManagerServer>::try_handle_request_by_id(self, req_id, protocol, server_ctx);
+        scratch::reset_after_dispatch();
+        rc
     }
 }
 
@@ -16,6 +16,9 @@ pub mod logger;
 
 pub mod rc;
 
+#[macro_use]
+pub mod scratch;
+
 #[macro_use]
 pub mod fsext;
 
@@ -29,4 +32,8 @@ pub mod amiibo;
 
 pub mod area;
 
+pub mod housekeeping;
+
+pub mod trace;
+
 pub use ipc::emu::{EmulationService, IEmulationServiceClient};
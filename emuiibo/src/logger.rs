@@ -1,59 +1,167 @@
 use crate::fsext;
-use alloc::string::String;
-use core::sync::atomic::AtomicBool;
+use core::fmt;
+use core::fmt::Write;
+use core::sync::atomic::AtomicU8;
+use core::sync::atomic::Ordering;
 use nx::fs;
 use nx::fs::FileAccessor;
 use nx::result::*;
 use nx::sync;
 
-static G_CAN_LOG: AtomicBool = AtomicBool::new(false);
-static G_LOG_FILE: sync::Mutex<Option<FileAccessor>> = sync::Mutex::new(None);
+/*
+Buffered logger: messages get formatted straight into a fixed buffer (no heap allocations), which only gets written to the log file in large blocks.
+The buffer is flushed by the housekeeping thread, or right away by whoever logs once it fills past a threshold.
+
+Logging is enabled with the "log" flag (info messages and above), or the "log_debug" flag (also debug messages, like the ones in NFP hot paths).
+*/
+
+#[derive(Copy, Clone, PartialEq, Eq, PartialOrd, Ord, Debug)]
+#[repr(u8)]
+pub enum LogLevel {
+    Debug,
+    Info,
+    Error,
+    // Only used as the threshold, to disable logging
+    None
+}
 
 const LOG_FLAG: &str = "log";
+const LOG_DEBUG_FLAG: &str = "log_debug";
 const LOG_FILE: &str = "sdmc:/emuiibo/emuiibo.log";
 
+const LOG_BUFFER_SIZE: usize = 0x2000;
+// Past this, the buffer is flushed before logging anything else (so any message up to LOG_BUFFER_SIZE - LOG_FLUSH_THRESHOLD bytes fits)
+const LOG_FLUSH_THRESHOLD: usize = 0x1000;
+
+struct LogBuffer {
+    data: [u8; LOG_BUFFER_SIZE],
+    len: usize
+}
+
+impl Write for LogBuffer {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        // Messages which don't fit get truncated
+        let copy_len = core::cmp::min(s.len(), LOG_BUFFER_SIZE - self.len);
+        self.data[self.len..self.len + copy_len].copy_from_slice(&s.as_bytes()[..copy_len]);
+        self.len += copy_len;
+        Ok(())
+    }
+}
+
+struct LogFile {
+    file: Option<FileAccessor>,
+    // Staging buffer for flush, kept here since writes are already serialized by this lock (and the flushing thread's stack is small)
+    pending: [u8; LOG_FLUSH_THRESHOLD]
+}
+
+static G_LOG_LEVEL: AtomicU8 = AtomicU8::new(LogLevel::None as u8);
+static G_LOG_BUFFER: sync::Mutex<LogBuffer> = sync::Mutex::new(LogBuffer { data: [0; LOG_BUFFER_SIZE], len: 0 });
+static G_LOG_FILE: sync::Mutex<LogFile> = sync::Mutex::new(LogFile { file: None, pending: [0; LOG_FLUSH_THRESHOLD] });
+
 pub fn initialize() -> Result<()> {
-    let can_log = fsext::has_flag(LOG_FLAG);
-    if can_log {
+    let level = if fsext::has_flag(LOG_DEBUG_FLAG) {
+        LogLevel::Debug
+    }
+    else if fsext::has_flag(LOG_FLAG) {
+        LogLevel::Info
+    }
+    else {
+        LogLevel::None
+    };
+
+    if level != LogLevel::None {
         let _ = fs::remove_file(LOG_FILE);
-        *G_LOG_FILE.lock() = Some(fs::open_file(
+        G_LOG_FILE.lock().file = Some(fs::open_file(
             LOG_FILE,
             fs::FileOpenOption::Create()
                 | fs::FileOpenOption::Write()
                 | fs::FileOpenOption::Append(),
         )?);
-        G_CAN_LOG.store(true, core::sync::atomic::Ordering::Release);
+        G_LOG_LEVEL.store(level as u8, Ordering::Release);
     }
 
     Ok(())
 }
 
-pub fn log_string(s: String) {
-    log_str(s.as_str())
+#[inline(always)]
+pub fn is_enabled(level: LogLevel) -> bool {
+    (level as u8) >= G_LOG_LEVEL.load(Ordering::Acquire)
 }
 
-#[inline(always)]
-pub fn log_str(log_str: &str) {
-    if G_CAN_LOG.load(core::sync::atomic::Ordering::Acquire) {
-        let _ = G_LOG_FILE
-            .lock()
-            .as_mut()
-            .expect("We only allow logging after the log file has been opened")
-            .write_array(log_str.as_bytes());
+fn write_to_file(data: &[u8]) {
+    if let Some(log_file) = G_LOG_FILE.lock().file.as_mut() {
+        let _ = log_file.write_array(data);
+    }
+}
+
+fn flush_buffer(log_buffer: &mut LogBuffer) {
+    write_to_file(&log_buffer.data[..log_buffer.len]);
+    log_buffer.len = 0;
+}
+
+pub fn log_fmt(level: LogLevel, args: fmt::Arguments) {
+    if is_enabled(level) {
+        let mut log_buffer = G_LOG_BUFFER.lock();
+        if log_buffer.len >= LOG_FLUSH_THRESHOLD {
+            flush_buffer(&mut log_buffer);
+        }
+        let _ = log_buffer.write_fmt(args);
+    }
+}
+
+// Called periodically by the housekeeping thread
+pub fn flush() {
+    if is_enabled(LogLevel::Error) {
+        // Copy the pending logs out, so that the file write doesn't block anyone logging meanwhile
+        // The file gets locked before releasing the buffer, so that logs are always written in order
+        loop {
+            let (mut log_file, pending_len) = {
+                let mut log_buffer = G_LOG_BUFFER.lock();
+                let pending_len = core::cmp::min(log_buffer.len, LOG_FLUSH_THRESHOLD);
+                if pending_len == 0 {
+                    break;
+                }
+
+                let mut log_file = G_LOG_FILE.lock();
+                log_file.pending[..pending_len].copy_from_slice(&log_buffer.data[..pending_len]);
+                let buffer_len = log_buffer.len;
+                log_buffer.data.copy_within(pending_len..buffer_len, 0);
+                log_buffer.len -= pending_len;
+                (log_file, pending_len)
+            };
+
+            let LogFile { file, pending } = &mut *log_file;
+            if let Some(file) = file.as_mut() {
+                let _ = file.write_array(&pending[..pending_len]);
+            }
+        }
     }
 }
 
+#[macro_export]
+macro_rules! log_level {
+    ($level:expr, $( $arg:tt )*) => {
+        $crate::logger::log_fmt($level, core::format_args!($( $arg )*))
+    };
+}
+
 #[macro_export]
 macro_rules! log {
-    ($msg:literal) => {
-        {
-            crate::logger::log_str($msg);
-        }
+    ($( $arg:tt )*) => {
+        $crate::log_level!($crate::logger::LogLevel::Info, $( $arg )*)
     };
-    ($fmt:literal, $( $params:expr ),*) => {
-        {
-            let msg = alloc::format!($fmt, $( $params ),*);
-            crate::logger::log_string(msg);
-        }
+}
+
+#[macro_export]
+macro_rules! log_debug {
+    ($( $arg:tt )*) => {
+        $crate::log_level!($crate::logger::LogLevel::Debug, $( $arg )*)
+    };
+}
+
+#[macro_export]
+macro_rules! log_error {
+    ($( $arg:tt )*) => {
+        $crate::log_level!($crate::logger::LogLevel::Error, $( $arg )*)
     };
 }
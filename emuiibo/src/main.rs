@@ -42,6 +42,8 @@ use nx::diag::log::LogSeverity;
 #[unsafe(no_mangle)]
 pub fn main() -> Result<()> {
     thread::set_current_thread_name("emuiibo.Main");
+    // This thread ends up running the IPC server
+    scratch::initialize();
     fs::initialize_fspsrv_session()?;
     fs::mount_sd_card("sdmc")?;
     fsext::ensure_directories()?;
@@ -50,6 +52,7 @@ pub fn main() -> Result<()> {
         let _a = rc;
     }
     log!("Logging Initialized!\n");
+    trace::initialize();
 
     if let Err(e) = nx::rand::initialize() {
         log!("Error initlializing rand provider: {:?}", e);
@@ -61,11 +64,7 @@ pub fn main() -> Result<()> {
         return Ok(());
     }
 
-    if let Err(e) = miiext::export_miis() {
-        log!("Error exporting mii module provider: {:?}", e);
-        return Ok(());
-    }
-
+    area::load_access_id_cache();
     amiibo::compat::convert_deprecated_virtual_amiibos();
     emu::load_emulation_status();
 
@@ -82,9 +81,16 @@ pub fn main() -> Result<()> {
     manager.register_mitm_service_server::<ipc::nfp::sys::SystemManager>()?;
     manager.register_service_server::<ipc::emu::EmulationServer>()?;
 
+    // Started once our services are registered, since it also takes care of exporting miis
+    if let Err(e) = housekeeping::initialize() {
+        log!("Error initializing housekeeping thread: {:?}", e);
+        return Ok(());
+    }
+
     if let Err(e) = manager.loop_process() {
         log!("Error occured running server manager loop: {:?}", e);
     }
+    logger::flush();
 
     panic!("exiting MitM Servers is not supported.");
 }
@@ -5,8 +5,10 @@ use nx::service::mii;
 use nx::service::mii::{DatabaseService, IDatabaseServiceClient};
 use nx::service::mii::IStaticServiceClient;
 use nx::sync::sys::mutex::Mutex;
+use nx::sync;
 use nx::fs;
 use alloc::vec::Vec;
+use crate::{rc, fsext};
 
 pub use generic_once_cell::OnceCell;
 
@@ -42,28 +44,116 @@ pub fn generate_random_mii() -> Result<mii::CharInfo> {
 }
 
 const MII_SOURCE_FLAG: mii::SourceFlag = mii::SourceFlag::Database();
+// Capacity of the console's mii database
+const MAX_MII_COUNT: usize = 100;
 pub const EXPORTED_MIIS_DIR: &'static str = "sdmc:/emuiibo/miis";
 
+/*
+Export manifest (miis/manifest.bin), so that only added/changed miis get written on each boot:
+
+- ExportManifestHeader
+- u64[count]: FNV-1a hash of each exported mii's charinfo, by index
+*/
+
+const EXPORT_MANIFEST_PATH: &'static str = "sdmc:/emuiibo/miis/manifest.bin";
+const EXPORT_MANIFEST_MAGIC: u32 = u32::from_le_bytes(*b"EMII");
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+struct ExportManifestHeader {
+    magic: u32,
+    count: u32
+}
+
+fn hash_charinfo(char_info: &mii::CharInfo) -> u64 {
+    // SAFETY: CharInfo is a plain repr(C) struct
+    let data = unsafe {
+        core::slice::from_raw_parts(char_info as *const _ as *const u8, core::mem::size_of::<mii::CharInfo>())
+    };
+
+    let mut hash: u64 = 0xCBF29CE484222325;
+    for byte in data {
+        hash ^= *byte as u64;
+        hash = hash.wrapping_mul(0x100000001B3);
+    }
+    hash
+}
+
+fn read_export_manifest() -> Vec<u64> {
+    let read_impl = || -> Result<Vec<u64>> {
+        let mut file = fs::open_file(EXPORT_MANIFEST_PATH, fs::FileOpenOption::Read())?;
+        let header: ExportManifestHeader = file.read_val()?;
+        result_return_unless!(header.magic == EXPORT_MANIFEST_MAGIC, rc::ResultInvalidMiiExportManifest);
+        // Don't trust the count before allocating anything for it
+        let max_file_count = (file.get_size()? - core::mem::size_of::<ExportManifestHeader>()) / core::mem::size_of::<u64>();
+        result_return_unless!((header.count as usize) <= max_file_count.min(MAX_MII_COUNT), rc::ResultInvalidMiiExportManifest);
+
+        let mut hashes: Vec<u64> = vec![0; header.count as usize];
+        file.read_array(&mut hashes)?;
+        Ok(hashes)
+    };
+
+    // Missing or invalid manifest: everything gets exported again
+    read_impl().unwrap_or_default()
+}
+
+fn write_export_manifest(hashes: &[u64]) -> Result<()> {
+    let header = ExportManifestHeader { magic: EXPORT_MANIFEST_MAGIC, count: hashes.len() as u32 };
+    let _ = fs::remove_file(EXPORT_MANIFEST_PATH);
+    let mut file = fs::open_file(EXPORT_MANIFEST_PATH, fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+    file.write_val(&header)?;
+    file.write_array(hashes)?;
+    Ok(())
+}
+
+fn export_mii(mii_dir_path: &str, mii: &mii::CharInfo) -> Result<()> {
+    let _ = fs::create_directory(mii_dir_path);
+
+    let mii_path = format!("{}/mii-charinfo.bin", mii_dir_path);
+    let _ = fs::remove_file(mii_path.as_str());
+    let mut mii_file = fs::open_file(mii_path.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+    mii_file.write_val(mii)?;
+
+    let mii_name = format!("{}/name.txt", mii_dir_path);
+    let _ = fs::remove_file(mii_name.as_str());
+    let mut mii_name_file = fs::open_file(mii_name.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+    let actual_name = mii.name.get_string()?;
+    mii_name_file.write_array(actual_name.as_bytes())?;
+    Ok(())
+}
+
+// nn::mii has no way to fetch a range of miis, so they all get fetched in a single call: into this static buffer (sized for a full database) rather than a heap allocation sized by whatever count the service reports
+static G_EXPORT_MIIS: sync::Mutex<[mii::CharInfo; MAX_MII_COUNT]> = sync::Mutex::new(unsafe { core::mem::zeroed() });
+
 pub fn export_miis() -> Result<()> {
-    let mii_count = get_database_service()?.get_count(MII_SOURCE_FLAG)?;
-    let miis: Vec<mii::CharInfo> = vec![Default::default(); mii_count as usize];
+    let miis = G_EXPORT_MIIS.lock();
+    let mii_total = (get_database_service()?.get_1(MII_SOURCE_FLAG, sf::Buffer::from_array(&miis[..]))? as usize).min(MAX_MII_COUNT);
 
-    let mii_total = get_database_service()?.get_1(MII_SOURCE_FLAG, sf::Buffer::from_array(&miis))?;
+    let old_hashes = read_export_manifest();
+    let mut hashes: Vec<u64> = Vec::with_capacity(mii_total);
+    let mut exported_count = 0;
     for i in 0..mii_total {
-        let mii = miis[i as usize];
+        let mii = &miis[i];
+        let hash = hash_charinfo(mii);
+        hashes.push(hash);
 
         let mii_dir_path = format!("{}/{}", EXPORTED_MIIS_DIR, i);
-        fs::create_directory(mii_dir_path.as_str())?;
+        // Also export it again if the user removed it
+        let unchanged = (old_hashes.get(i) == Some(&hash)) && fsext::exists_file(format!("{}/mii-charinfo.bin", mii_dir_path));
+        if !unchanged {
+            export_mii(mii_dir_path.as_str(), mii)?;
+            exported_count += 1;
+        }
+    }
 
-        let mii_path = format!("{}/mii-charinfo.bin", mii_dir_path);
-        let mut mii_file = fs::open_file(mii_path.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
-        mii_file.write_val(&mii)?;
+    // Miis which were removed from the database
+    for i in mii_total..old_hashes.len() {
+        let _ = fs::remove_dir_all(format!("{}/{}", EXPORTED_MIIS_DIR, i).as_str());
+    }
 
-        let mii_name = format!("{}/name.txt", mii_dir_path);
-        let mut mii_name_file = fs::open_file(mii_name.as_str(), fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
-        let actual_name = mii.name.get_string()?;
-        mii_name_file.write_array(actual_name.as_bytes())?;
+    if hashes != old_hashes {
+        write_export_manifest(&hashes)?;
     }
-    
+    log!("Exported {} miis ({} unchanged)\n", exported_count, mii_total - exported_count);
     Ok(())
-}
\ No newline at end of file
+}
@@ -8,5 +8,8 @@ result_define_group!(RESULT_MODULE => {
     InvalidLoadedVirtualAmiibo: 5,
     VirtualAmiiboAreasJsonNotFound: 6,
     InvalidActiveVirtualAmiibo: 7,
-    InvalidVirtualAmiiboAccessId: 8
+    InvalidVirtualAmiiboAccessId: 8,
+    AccessIdNotCached: 9,
+    InvalidVirtualAmiiboMeta: 10,
+    InvalidMiiExportManifest: 11
 });
\ No newline at end of file
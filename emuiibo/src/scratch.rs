@@ -0,0 +1,173 @@
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::cell::{Cell, RefCell};
+use core::fmt;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicU32, AtomicUsize, Ordering};
+
+/*
+Scratch arena for short-lived strings (paths...), which would otherwise be lots of small allocations on our tiny heap.
+
+A Scope is entered by whatever needs scratch strings while handling a request, and everything formatted through it is released at once when it's dropped.
+Scopes nest like a stack: only the innermost one allocates from the arena, and anything which doesn't fit (or comes from an outer scope meanwhile) falls back to the heap.
+The arena belongs to the thread which initialized it (the main thread, which then runs the IPC server): scopes entered from any other thread (housekeeping...) just use the heap.
+The arena is also reset after every IPC request gets handled, so that a leaked scope can't keep it occupied.
+*/
+
+pub const SCRATCH_ARENA_SIZE: usize = 0x1000;
+
+static mut G_SCRATCH_ARENA: [u8; SCRATCH_ARENA_SIZE] = [0; SCRATCH_ARENA_SIZE];
+static G_SCRATCH_OFFSET: AtomicUsize = AtomicUsize::new(0);
+static G_SCRATCH_DEPTH: AtomicUsize = AtomicUsize::new(0);
+// See get_current_thread_id, 0 until initialized (so no thread owns the arena)
+static G_SCRATCH_OWNER_THREAD: AtomicUsize = AtomicUsize::new(0);
+
+// Instrumentation, see the emulation service's debug command
+static G_SCRATCH_HIGH_WATER_MARK: AtomicUsize = AtomicUsize::new(0);
+static G_SCRATCH_HEAP_FALLBACK_COUNT: AtomicU32 = AtomicU32::new(0);
+
+#[derive(nx::ipc::sf::Request, nx::ipc::sf::Response, Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct ScratchStats {
+    pub arena_size: u32,
+    pub arena_high_water_mark: u32,
+    pub heap_fallback_count: u32,
+    pub reserved: u32
+}
+
+pub fn get_stats() -> ScratchStats {
+    ScratchStats {
+        arena_size: SCRATCH_ARENA_SIZE as u32,
+        arena_high_water_mark: G_SCRATCH_HIGH_WATER_MARK.load(Ordering::Relaxed) as u32,
+        heap_fallback_count: G_SCRATCH_HEAP_FALLBACK_COUNT.load(Ordering::Relaxed),
+        reserved: 0
+    }
+}
+
+#[inline(always)]
+fn get_current_thread_id() -> usize {
+    // The thread local region's address (TPIDRRO_EL0) is unique to each thread, and way cheaper to get than asking the kernel for the thread's ID
+    let tlr: usize;
+    unsafe {
+        core::arch::asm!("mrs {}, tpidrro_el0", out(reg) tlr, options(nomem, nostack, preserves_flags));
+    }
+    tlr
+}
+
+#[inline(always)]
+fn is_owner_thread() -> bool {
+    G_SCRATCH_OWNER_THREAD.load(Ordering::Acquire) == get_current_thread_id()
+}
+
+// Makes the calling thread the arena's owner, must be called before any scope gets entered
+pub fn initialize() {
+    G_SCRATCH_OWNER_THREAD.store(get_current_thread_id(), Ordering::Release);
+}
+
+// Called once each IPC request was handled: no scope can legitimately be alive by then
+pub fn reset_after_dispatch() {
+    if is_owner_thread() {
+        G_SCRATCH_OFFSET.store(0, Ordering::Release);
+        G_SCRATCH_DEPTH.store(0, Ordering::Release);
+    }
+}
+
+struct ArenaWriter {
+    offset: usize,
+    overflowed: bool
+}
+
+impl Write for ArenaWriter {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        let bytes = s.as_bytes();
+        if self.overflowed || (self.offset + bytes.len() > SCRATCH_ARENA_SIZE) {
+            self.overflowed = true;
+            return Err(fmt::Error);
+        }
+
+        // SAFETY: the range is within the arena, and past every string still in use (see Scope)
+        unsafe {
+            let arena_ptr = &raw mut G_SCRATCH_ARENA as *mut u8;
+            core::ptr::copy_nonoverlapping(bytes.as_ptr(), arena_ptr.add(self.offset), bytes.len());
+        }
+        self.offset += bytes.len();
+        Ok(())
+    }
+}
+
+pub struct Scope {
+    // 0 if the scope wasn't entered from the owner thread, thus only allocating from the heap
+    depth: usize,
+    start_offset: usize,
+    heap_strings: RefCell<Vec<String>>,
+    // Not Send: scopes are tied to the thread entering them
+    _not_send: core::marker::PhantomData<Cell<()>>
+}
+
+impl Scope {
+    pub fn enter() -> Self {
+        let (depth, start_offset) = match is_owner_thread() {
+            true => (G_SCRATCH_DEPTH.fetch_add(1, Ordering::AcqRel) + 1, G_SCRATCH_OFFSET.load(Ordering::Acquire)),
+            false => (0, 0)
+        };
+        Self {
+            depth,
+            start_offset,
+            heap_strings: RefCell::new(Vec::new()),
+            _not_send: core::marker::PhantomData
+        }
+    }
+
+    fn format_in_arena<'a>(&'a self, args: fmt::Arguments) -> Option<&'a str> {
+        if (self.depth == 0) || (G_SCRATCH_DEPTH.load(Ordering::Acquire) != self.depth) {
+            return None;
+        }
+
+        let start = G_SCRATCH_OFFSET.load(Ordering::Acquire);
+        let mut writer = ArenaWriter { offset: start, overflowed: false };
+        if writer.write_fmt(args).is_err() {
+            return None;
+        }
+
+        G_SCRATCH_OFFSET.store(writer.offset, Ordering::Release);
+        G_SCRATCH_HIGH_WATER_MARK.fetch_max(writer.offset, Ordering::Relaxed);
+
+        // SAFETY: the range was just filled with UTF-8 and is only reused once this scope gets dropped
+        unsafe {
+            let arena_ptr = &raw const G_SCRATCH_ARENA as *const u8;
+            Some(core::str::from_utf8_unchecked(core::slice::from_raw_parts(arena_ptr.add(start), writer.offset - start)))
+        }
+    }
+
+    pub fn format<'a>(&'a self, args: fmt::Arguments) -> &'a str {
+        if let Some(s) = self.format_in_arena(args) {
+            return s;
+        }
+
+        G_SCRATCH_HEAP_FALLBACK_COUNT.fetch_add(1, Ordering::Relaxed);
+        let mut heap_strings = self.heap_strings.borrow_mut();
+        heap_strings.push(alloc::fmt::format(args));
+        let s = heap_strings.last().unwrap();
+
+        // SAFETY: the string's buffer doesn't move or get freed while it's kept in heap_strings, which lives as long as the scope
+        unsafe {
+            core::str::from_utf8_unchecked(core::slice::from_raw_parts(s.as_ptr(), s.len()))
+        }
+    }
+}
+
+impl Drop for Scope {
+    fn drop(&mut self) {
+        // Release everything allocated since the scope was entered
+        if self.depth != 0 {
+            G_SCRATCH_OFFSET.store(self.start_offset, Ordering::Release);
+            G_SCRATCH_DEPTH.store(self.depth - 1, Ordering::Release);
+        }
+    }
+}
+
+macro_rules! scratch_format {
+    ($scope:expr, $( $arg:tt )*) => {
+        $scope.format(core::format_args!($( $arg )*))
+    };
+}
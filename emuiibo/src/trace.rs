@@ -0,0 +1,188 @@
+use core::sync::atomic::{AtomicBool, Ordering};
+use nx::arm;
+use nx::fs;
+use nx::result::*;
+use nx::sync;
+use crate::amiibo::bin::Buffer;
+use crate::fsext;
+
+/*
+NFP command trace recorder, enabled by the "trace" flag: every command handled by the mitm'd nfp interfaces gets recorded (command ID, application ID, start/end ticks and result) in a fixed ring buffer, which is dumped by the housekeeping thread to trace.bin:
+
+- TraceHeader
+- TraceEntry[entry_count], oldest first
+
+The layout is decoded by the overlay's host tools (emuiibo-trace), which print per-command latency histograms.
+*/
+
+pub const TRACE_FILE: &str = "sdmc:/emuiibo/trace.bin";
+pub const TRACE_MAGIC: u32 = u32::from_le_bytes(*b"ETRC");
+pub const TRACE_VERSION: u16 = 1;
+
+const TRACE_FLAG: &str = "trace";
+const TRACE_CAPACITY: usize = 0x100;
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug)]
+#[repr(u8)]
+pub enum TraceInterface {
+    User,
+    System
+}
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct TraceHeader {
+    pub magic: u32,
+    pub version: u16,
+    pub entry_size: u16,
+    pub tick_frequency: u64,
+    pub entry_count: u32,
+    pub dropped_count: u32
+}
+const_assert!(core::mem::size_of::<TraceHeader>() == 0x18);
+
+impl Buffer for TraceHeader {}
+
+#[derive(Copy, Clone, PartialEq, Eq, Debug, Default)]
+#[repr(C)]
+pub struct TraceEntry {
+    pub application_id: u64,
+    pub start_tick: u64,
+    pub end_tick: u64,
+    pub command_id: u16,
+    pub interface: u8,
+    // Whether the command was handled by us, otherwise it was forwarded to the real nfp service
+    pub handled: u8,
+    pub result: u32
+}
+const_assert!(core::mem::size_of::<TraceEntry>() == 0x20);
+
+impl Buffer for TraceEntry {}
+
+struct TraceState {
+    entries: [TraceEntry; TRACE_CAPACITY],
+    next_index: usize,
+    count: usize,
+    dropped_count: u32,
+    dirty: bool
+}
+
+static G_TRACE_ENABLED: AtomicBool = AtomicBool::new(false);
+static G_TRACE_STATE: sync::Mutex<TraceState> = sync::Mutex::new(TraceState {
+    entries: [TraceEntry { application_id: 0, start_tick: 0, end_tick: 0, command_id: 0, interface: 0, handled: 0, result: 0 }; TRACE_CAPACITY],
+    next_index: 0,
+    count: 0,
+    dropped_count: 0,
+    dirty: false
+});
+
+pub fn initialize() {
+    G_TRACE_ENABLED.store(fsext::has_flag(TRACE_FLAG), Ordering::Release);
+}
+
+#[inline(always)]
+pub fn is_enabled() -> bool {
+    G_TRACE_ENABLED.load(Ordering::Acquire)
+}
+
+#[inline(always)]
+pub fn begin() -> u64 {
+    if is_enabled() {
+        arm::get_system_tick()
+    }
+    else {
+        0
+    }
+}
+
+pub fn record(interface: TraceInterface, command_id: u32, application_id: u64, start_tick: u64, rc: &Option<Result<()>>) {
+    if !is_enabled() {
+        return;
+    }
+
+    let end_tick = arm::get_system_tick();
+    let (handled, result) = match rc {
+        Some(Ok(())) => (1, 0),
+        Some(Err(rc)) => (1, rc.get_value()),
+        None => (0, 0)
+    };
+
+    let mut state = G_TRACE_STATE.lock();
+    let index = state.next_index;
+    state.entries[index] = TraceEntry { application_id, start_tick, end_tick, command_id: command_id as u16, interface: interface as u8, handled, result };
+    state.next_index = (index + 1) % TRACE_CAPACITY;
+    if state.count < TRACE_CAPACITY {
+        state.count += 1;
+    }
+    else {
+        // The oldest entry was overwritten
+        state.dropped_count += 1;
+    }
+    state.dirty = true;
+}
+
+#[repr(C)]
+struct TraceSnapshot {
+    header: TraceHeader,
+    // Oldest first, only the first header.entry_count ones are valid
+    entries: [TraceEntry; TRACE_CAPACITY]
+}
+
+const_assert!(core::mem::offset_of!(TraceSnapshot, entries) == core::mem::size_of::<TraceHeader>());
+
+impl Buffer for TraceSnapshot {}
+
+// Filled under G_TRACE_STATE and written out after releasing it, so that recording commands never waits on the SD card
+// Static rather than on the (small) stack of the thread dumping it
+static G_TRACE_SNAPSHOT: sync::Mutex<TraceSnapshot> = sync::Mutex::new(TraceSnapshot {
+    header: TraceHeader { magic: 0, version: 0, entry_size: 0, tick_frequency: 0, entry_count: 0, dropped_count: 0 },
+    entries: [TraceEntry { application_id: 0, start_tick: 0, end_tick: 0, command_id: 0, interface: 0, handled: 0, result: 0 }; TRACE_CAPACITY]
+});
+
+// Called periodically by the housekeeping thread, only writes anything if new commands got recorded
+pub fn dump() -> Result<()> {
+    if !is_enabled() {
+        return Ok(());
+    }
+
+    let mut snapshot = G_TRACE_SNAPSHOT.lock();
+    {
+        let mut state = G_TRACE_STATE.lock();
+        if !state.dirty {
+            return Ok(());
+        }
+
+        snapshot.header = TraceHeader {
+            magic: TRACE_MAGIC,
+            version: TRACE_VERSION,
+            entry_size: core::mem::size_of::<TraceEntry>() as u16,
+            tick_frequency: arm::get_system_tick_frequency(),
+            entry_count: state.count as u32,
+            dropped_count: state.dropped_count
+        };
+
+        // Oldest first: once the buffer wrapped around, the oldest entry is the next one to be overwritten
+        let first_index = if state.count < TRACE_CAPACITY { 0 } else { state.next_index };
+        for i in 0..state.count {
+            snapshot.entries[i] = state.entries[(first_index + i) % TRACE_CAPACITY];
+        }
+
+        state.dirty = false;
+    }
+
+    // Header and entries are contiguous in the snapshot, so a single write is enough
+    let dump_size = core::mem::size_of::<TraceHeader>() + snapshot.header.entry_count as usize * core::mem::size_of::<TraceEntry>();
+    let write_impl = || -> Result<()> {
+        let _ = fs::remove_file(TRACE_FILE);
+        let mut file = fs::open_file(TRACE_FILE, fs::FileOpenOption::Create() | fs::FileOpenOption::Write() | fs::FileOpenOption::Append())?;
+        file.write_array(&snapshot.get_buf()[..dump_size])?;
+        Ok(())
+    };
+
+    let rc = write_impl();
+    if rc.is_err() {
+        // Try again next time
+        G_TRACE_STATE.lock().dirty = true;
+    }
+    rc
+}
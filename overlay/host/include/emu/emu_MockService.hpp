@@ -0,0 +1,14 @@
+#pragma once
+#include <emu/emu_Service.hpp>
+
+// Host-only controls of the in-process emuiibo service (host/source/emu_MockService.cpp)
+
+namespace emu::mock {
+
+    // Every service call sleeps this long, to emulate IPC round-trips
+    void SetCallLatency(const u64 latency_ns);
+
+    u64 GetCallCount();
+    void ResetCallCount();
+
+}
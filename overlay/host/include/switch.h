@@ -0,0 +1,48 @@
+#pragma once
+// Minimal subset of libnx needed to build the overlay's data paths on the host (see host/Makefile)
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+
+#define R_SUCCEEDED(res) ((res) == 0)
+#define R_FAILED(res) ((res) != 0)
+#define MAKERESULT(module, description) ((((module) & 0x1FF)) | ((description) & 0x1FFF) << 9)
+
+#define FS_MAX_PATH 0x301
+
+typedef struct {
+    u8 data[0x58];
+} MiiCharInfo;
+
+inline Result pmdmntGetApplicationProcessId(u64 *out_pid) {
+    *out_pid = 0;
+    return MAKERESULT(15, 1);
+}
+
+inline Result pmdmntGetProgramId(u64 *out_program_id, u64 pid) {
+    *out_program_id = 0;
+    return MAKERESULT(15, 1);
+}
+
+inline Result setInitialize() {
+    return 0;
+}
+
+inline void setExit() {}
+
+inline Result setGetSystemLanguage(u64 *out_lang_code) {
+    *out_lang_code = 0;
+    memcpy(out_lang_code, "en-US", sizeof("en-US"));
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+// Host stand-in for libtesla: the SD card and sm are always "mounted", so these just run the callback
+#include <switch.h>
+
+namespace tsl::hlp {
+
+    template<typename F>
+    inline void doWithSDCardHandle(F f) {
+        f();
+    }
+
+    template<typename F>
+    inline void doWithSmSession(F f) {
+        f();
+    }
+
+}
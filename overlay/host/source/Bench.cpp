@@ -0,0 +1,491 @@
+#include <emu/emu_MockService.hpp>
+#include <app/app_Favorites.hpp>
+#include <app/app_Folder.hpp>
+#include <app/app_Paths.hpp>
+#include <app/app_SearchIndex.hpp>
+#include <tr/tr_Translation.hpp>
+#include <tr/json.hpp>
+#include <ui/ui_PngImage.hpp>
+#include <ui/upng.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Microbenchmarks of the overlay's hot paths, run on the host against the mock emuiibo service
+// A synthetic SD root (icons, translations, thousands of virtual amiibos) is generated in a temporary directory, and results are printed as JSON
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    // Same as Main.cpp's icon bounds (with the default 448px layer width)
+    constexpr u32 IconMaxWidth = (448 / 2) - 2 * 5;
+    constexpr u32 IconMaxHeight = 100 - 2 * 5;
+
+    constexpr size_t DefaultAmiiboCount = 4000;
+    constexpr size_t AmiibosPerSeries = 200;
+    constexpr size_t FavoriteInterval = 8;
+    constexpr size_t SampleCount = 15;
+
+    struct Options {
+        size_t amiibo_count = DefaultAmiiboCount;
+        u64 latency_us = 0;
+        std::string lang_dir = "lang";
+        std::string icon_dir;
+        std::string output_path;
+    };
+
+    struct BenchResult {
+        std::string name;
+        size_t ops_per_sample;
+        std::vector<double> sample_ns_per_op;
+    };
+
+    std::vector<BenchResult> g_Results;
+    volatile size_t g_Sink;
+
+    template<typename F>
+    void RunBench(const std::string &name, const size_t ops_per_sample, F fn) {
+        // Warm-up run, not measured
+        fn();
+
+        BenchResult result = { name, ops_per_sample, {} };
+        for(size_t i = 0; i < SampleCount; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            result.sample_ns_per_op.push_back(elapsed / (double)ops_per_sample);
+        }
+        fprintf(stderr, "  %-40s done\n", name.c_str());
+        g_Results.push_back(std::move(result));
+    }
+
+    nlohmann::ordered_json MakeResultsJson(const Options &opts) {
+        auto results_json = nlohmann::ordered_json::object();
+        results_json["version"] = std::to_string(VER_MAJOR) + "." + std::to_string(VER_MINOR) + "." + std::to_string(VER_MICRO);
+        results_json["amiibo_count"] = opts.amiibo_count;
+        results_json["call_latency_us"] = opts.latency_us;
+        results_json["samples"] = SampleCount;
+
+        auto benchs_json = nlohmann::ordered_json::array();
+        for(const auto &result: g_Results) {
+            auto sorted = result.sample_ns_per_op;
+            std::sort(sorted.begin(), sorted.end());
+            double total = 0;
+            for(const auto ns: sorted) {
+                total += ns;
+            }
+
+            benchs_json.push_back({
+                { "name", result.name },
+                { "ops_per_sample", result.ops_per_sample },
+                { "ns_per_op_min", sorted.front() },
+                { "ns_per_op_median", sorted.at(sorted.size() / 2) },
+                { "ns_per_op_mean", total / (double)sorted.size() },
+                { "ns_per_op_max", sorted.back() }
+            });
+        }
+        results_json["benchmarks"] = benchs_json;
+        return results_json;
+    }
+
+    // Minimal PNG writer (RGBA8, stored deflate blocks), enough for a synthetic icon corpus
+
+    u32 Crc32(const u8 *data, const size_t size, u32 crc = 0) {
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++) {
+            crc ^= data[i];
+            for(u32 j = 0; j < 8; j++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+            }
+        }
+        return ~crc;
+    }
+
+    inline void PushU32BE(std::vector<u8> &buf, const u32 val) {
+        buf.push_back(val >> 24);
+        buf.push_back(val >> 16);
+        buf.push_back(val >> 8);
+        buf.push_back(val);
+    }
+
+    void PushChunk(std::vector<u8> &png, const char *type, const std::vector<u8> &data) {
+        PushU32BE(png, data.size());
+        std::vector<u8> type_data(type, type + 4);
+        type_data.insert(type_data.end(), data.begin(), data.end());
+        png.insert(png.end(), type_data.begin(), type_data.end());
+        PushU32BE(png, Crc32(type_data.data(), type_data.size()));
+    }
+
+    void WriteSyntheticPng(const std::string &path, const u32 width, const u32 height, const u32 seed) {
+        std::vector<u8> raw;
+        raw.reserve((width * 4 + 1) * height);
+        for(u32 y = 0; y < height; y++) {
+            // No filtering
+            raw.push_back(0);
+            for(u32 x = 0; x < width; x++) {
+                raw.push_back((x * 3 + seed) & 0xFF);
+                raw.push_back((y * 5 + seed) & 0xFF);
+                raw.push_back(((x ^ y) + seed) & 0xFF);
+                raw.push_back(((x * y) & 0x80) ? 0xFF : 0x00);
+            }
+        }
+
+        std::vector<u8> zlib = { 0x78, 0x01 };
+        for(size_t offset = 0; offset < raw.size(); offset += 0xFFFF) {
+            const u16 block_size = std::min<size_t>(0xFFFF, raw.size() - offset);
+            const auto is_final = (offset + block_size) >= raw.size();
+            zlib.push_back(is_final ? 1 : 0);
+            zlib.push_back(block_size & 0xFF);
+            zlib.push_back(block_size >> 8);
+            zlib.push_back(~block_size & 0xFF);
+            zlib.push_back((~block_size >> 8) & 0xFF);
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block_size);
+        }
+        u32 a = 1;
+        u32 b = 0;
+        for(const auto byte: raw) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        PushU32BE(zlib, (b << 16) | a);
+
+        std::vector<u8> ihdr;
+        PushU32BE(ihdr, width);
+        PushU32BE(ihdr, height);
+        // 8-bit RGBA, default compression/filter, no interlacing
+        ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 });
+
+        std::vector<u8> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        PushChunk(png, "IHDR", ihdr);
+        PushChunk(png, "IDAT", zlib);
+        PushChunk(png, "IEND", {});
+
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(png.data()), png.size());
+    }
+
+    void WriteFile(const fs::path &path, const std::string &data) {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs << data;
+    }
+
+    std::string MakeAmiiboJson(const size_t idx) {
+        return nlohmann::json({
+            { "name", "Amiibo " + std::to_string(idx) },
+            { "uuid", { 4, idx & 0xFF, (idx >> 8) & 0xFF, 1, 2, 3, 4, 0, 0, 0 } },
+            { "use_random_uuid", (idx % 2) == 0 },
+            { "first_write_date", { { "y", 2020 }, { "m", 1 }, { "d", 1 } } },
+            { "last_write_date", { { "y", 2023 }, { "m", 6 }, { "d", 15 } } },
+            { "id", { { "game_character_id", idx & 0xFFFF }, { "character_variant", 0 }, { "figure_type", 0 }, { "model_number", 0 }, { "series", 0 } } },
+            { "mii_charinfo_file", "mii-charinfo.bin" },
+            { "version", 0 },
+            { "write_counter", 0 }
+        }).dump(4);
+    }
+
+    // Layout: sdmc:/emuiibo/amiibo/series-<n>/amiibo-<n> (plus one flat folder with every amiibo, for the big listing), sdmc:/emuiibo/overlay/{lang,favorites.txt}
+    std::vector<std::string> GenerateSdRoot(const fs::path &sd_root, const Options &opts) {
+        const auto emuiibo_dir = sd_root / "sdmc:" / "emuiibo";
+        fs::create_directories(emuiibo_dir / "overlay");
+        fs::copy(opts.lang_dir, emuiibo_dir / "overlay" / "lang", fs::copy_options::recursive);
+
+        const std::string mii_charinfo(0x58, '\0');
+        std::vector<std::string> favorites;
+        for(size_t i = 0; i < opts.amiibo_count; i++) {
+            const auto series = "series-" + std::to_string(i / AmiibosPerSeries);
+            const auto name = "amiibo-" + std::to_string(i);
+            for(const auto &parent: { emuiibo_dir / "amiibo" / "all", emuiibo_dir / "amiibo" / series }) {
+                const auto amiibo_dir = parent / name;
+                fs::create_directories(amiibo_dir / "areas");
+                WriteFile(amiibo_dir / "amiibo.flag", "");
+                WriteFile(amiibo_dir / "amiibo.json", MakeAmiiboJson(i));
+                WriteFile(amiibo_dir / "areas.json", R"({"areas":[],"current_area_access_id":0})");
+                WriteFile(amiibo_dir / "mii-charinfo.bin", mii_charinfo);
+            }
+            if((i % FavoriteInterval) == 0) {
+                favorites.push_back("sdmc:/emuiibo/amiibo/" + series + "/" + name);
+            }
+        }
+
+        std::ofstream favs_file(emuiibo_dir / "overlay" / "favorites.txt");
+        for(const auto &fav: favorites) {
+            favs_file << fav << std::endl;
+        }
+        return favorites;
+    }
+
+    std::vector<std::string> LoadIconCorpus(const fs::path &sd_root, const Options &opts) {
+        std::vector<std::string> icons;
+        if(!opts.icon_dir.empty()) {
+            for(const auto &entry: fs::recursive_directory_iterator(opts.icon_dir)) {
+                if(entry.is_regular_file() && (entry.path().extension() == ".png")) {
+                    icons.push_back(fs::absolute(entry.path()).string());
+                }
+            }
+        }
+        else {
+            // Typical amiibo render sizes
+            const auto icon_dir = sd_root / "icons";
+            fs::create_directories(icon_dir);
+            const std::pair<u32, u32> sizes[] = { { 256, 256 }, { 300, 400 }, { 512, 512 }, { 180, 320 } };
+            u32 seed = 0;
+            for(const auto &[w, h]: sizes) {
+                const auto path = (icon_dir / ("icon-" + std::to_string(w) + "x" + std::to_string(h) + ".png")).string();
+                WriteSyntheticPng(path, w, h, seed++);
+                icons.push_back(path);
+            }
+        }
+        std::sort(icons.begin(), icons.end());
+        return icons;
+    }
+
+    std::vector<u8> ReadFile(const std::string &path) {
+        std::ifstream ifs(path, std::ios::binary);
+        return std::vector<u8>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    void RunPngBenchs(const std::vector<std::string> &icons) {
+        std::vector<std::vector<u8>> icon_datas;
+        for(const auto &icon: icons) {
+            icon_datas.push_back(ReadFile(icon));
+        }
+
+        RunBench("upng_decode", icon_datas.size(), [&]() {
+            for(const auto &data: icon_datas) {
+                auto upng = upng_new_from_bytes(data.data(), data.size());
+                upng_decode(upng);
+                g_Sink = upng_get_size(upng);
+                upng_free(upng);
+            }
+        });
+
+        ui::PngImage img;
+        RunBench("PngImage::Load", icons.size(), [&]() {
+            for(const auto &icon: icons) {
+                img.Load(icon, IconMaxWidth, IconMaxHeight);
+                g_Sink = img.GetWidth();
+            }
+        });
+    }
+
+    void RunTranslationBenchs(const std::string &lang_dir) {
+        std::vector<std::string> keys;
+        {
+            std::ifstream ifs(fs::path(lang_dir) / "en.json");
+            for(const auto &str: nlohmann::json::parse(ifs)["strings"]) {
+                keys.push_back(str["key"].get<std::string>());
+            }
+        }
+        keys.push_back("MissingTranslationKey");
+
+        constexpr size_t LoadCount = 20;
+        RunBench("tr::Load", LoadCount, [&]() {
+            for(size_t i = 0; i < LoadCount; i++) {
+                g_Sink = tr::Load();
+            }
+        });
+
+        constexpr size_t TranslateRounds = 1000;
+        RunBench("tr::Translate", keys.size() * TranslateRounds, [&]() {
+            for(size_t i = 0; i < TranslateRounds; i++) {
+                for(const auto &key: keys) {
+                    g_Sink = tr::Translate(key).size();
+                }
+            }
+        });
+    }
+
+    void RunPathBenchs(const std::vector<std::string> &favorites) {
+        const std::string ref_path = "sdmc:/emuiibo/amiibo";
+        constexpr size_t Rounds = 50;
+
+        RunBench("app::SplitPath", favorites.size() * Rounds, [&]() {
+            for(size_t i = 0; i < Rounds; i++) {
+                for(const auto &path: favorites) {
+                    g_Sink = app::SplitPath(path).size();
+                }
+            }
+        });
+
+        RunBench("app::GetRelativePathTo", favorites.size() * Rounds, [&]() {
+            for(size_t i = 0; i < Rounds; i++) {
+                for(const auto &path: favorites) {
+                    g_Sink = app::GetRelativePathTo(ref_path, path).size();
+                }
+            }
+        });
+    }
+
+    void RunFavoritesBenchs() {
+        RunBench("app::LoadFavorites", 1, []() {
+            app::LoadFavorites();
+        });
+
+        // Every element of a listing checks whether it is a favorite
+        const auto paths = app::ListDirectories("sdmc:/emuiibo/amiibo/all");
+        std::vector<std::string> series_paths;
+        for(const auto &series_path: app::ListDirectories("sdmc:/emuiibo/amiibo")) {
+            for(const auto &path: app::ListDirectories(series_path)) {
+                series_paths.push_back(path);
+            }
+        }
+        RunBench("app::IsFavorite", paths.size() + series_paths.size(), [&]() {
+            size_t count = 0;
+            for(const auto &path: paths) {
+                count += app::IsFavorite(path);
+            }
+            for(const auto &path: series_paths) {
+                count += app::IsFavorite(path);
+            }
+            g_Sink = count;
+        });
+
+        // Opening the favorites view: probing every favorite (what it used to do) against the cached display data
+        const auto &favorites = app::GetFavorites();
+        RunBench("favorites_listing_probe", favorites.size(), [&]() {
+            g_Sink = app::ClassifyEntries(favorites).size();
+        });
+        RunBench("favorites_listing_cached", favorites.size(), []() {
+            g_Sink = app::GetFavoritesDisplayData().size();
+        });
+
+        // Every favorite's stamp checked, as the view does a few per frame
+        RunBench("app::RevalidateFavorites", favorites.size(), []() {
+            size_t count = 0;
+            app::StartFavoritesRevalidation();
+            for(size_t i = 0; i < app::GetFavorites().size(); i += 4) {
+                app::RevalidateFavorites(4, [&](const std::string&, const app::FavoriteDisplayData&) {
+                    count++;
+                });
+            }
+            g_Sink = count;
+        });
+    }
+
+    void RunFolderBenchs(const Options &opts) {
+        RunBench("app::ListDirectories", opts.amiibo_count, []() {
+            g_Sink = app::ListDirectories("sdmc:/emuiibo/amiibo/all").size();
+        });
+
+        const auto paths = app::ListDirectories("sdmc:/emuiibo/amiibo/all");
+        RunBench("app::ClassifyEntries", paths.size(), [&]() {
+            g_Sink = app::ClassifyEntries(paths).size();
+        });
+
+        // What AmiiboGui does when opening the folder
+        RunBench("folder_listing", opts.amiibo_count, []() {
+            g_Sink = app::ClassifyEntries(app::ListDirectories("sdmc:/emuiibo/amiibo/all")).size();
+        });
+    }
+
+    void RunSearchBenchs() {
+        app::LoadSearchIndex("sdmc:/emuiibo/amiibo");
+        RunBench("app::RebuildSearchIndex", 1, []() {
+            app::RebuildSearchIndex();
+            g_Sink = app::GetSearchIndexEntryCount();
+        });
+
+        // What AmiiboSearchGui does on every keystroke, typing a few names character by character
+        std::vector<std::string> queries;
+        for(const std::string name: { "amiibo-1234", "series-3/amiibo-7", "ibo-42", "zzz" }) {
+            for(size_t i = 1; i <= name.length(); i++) {
+                queries.push_back(name.substr(0, i));
+            }
+        }
+        RunBench("app::Search", queries.size(), [&]() {
+            size_t count = 0;
+            for(const auto &query: queries) {
+                count += app::Search(query, 50).size();
+            }
+            g_Sink = count;
+        });
+    }
+
+    bool ParseOptions(const int argc, char **argv, Options &out_opts) {
+        for(int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if((i + 1) >= argc) {
+                return false;
+            }
+            const std::string val = argv[++i];
+
+            if(arg == "--amiibos") {
+                out_opts.amiibo_count = strtoull(val.c_str(), nullptr, 10);
+            }
+            else if(arg == "--latency-us") {
+                out_opts.latency_us = strtoull(val.c_str(), nullptr, 10);
+            }
+            else if(arg == "--lang") {
+                out_opts.lang_dir = fs::absolute(val).string();
+            }
+            else if(arg == "--icons") {
+                out_opts.icon_dir = fs::absolute(val).string();
+            }
+            else if(arg == "--output") {
+                out_opts.output_path = fs::absolute(val).string();
+            }
+            else {
+                return false;
+            }
+        }
+        return out_opts.amiibo_count > 0;
+    }
+
+}
+
+int main(int argc, char **argv) {
+    Options opts;
+    if(!ParseOptions(argc, argv, opts)) {
+        fprintf(stderr, "Usage: %s [--amiibos <count>] [--latency-us <us>] [--lang <dir>] [--icons <dir>] [--output <json-file>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    opts.lang_dir = fs::absolute(opts.lang_dir).string();
+
+    char sd_root_tmpl[] = "/tmp/emuiibo-bench-XXXXXX";
+    if(mkdtemp(sd_root_tmpl) == nullptr) {
+        fprintf(stderr, "Unable to create the synthetic SD root\n");
+        return EXIT_FAILURE;
+    }
+    const fs::path sd_root = sd_root_tmpl;
+
+    fprintf(stderr, "Generating %zu virtual amiibos in %s...\n", opts.amiibo_count, sd_root.c_str());
+    const auto favorites = GenerateSdRoot(sd_root, opts);
+    const auto icons = LoadIconCorpus(sd_root, opts);
+    if(chdir(sd_root.c_str()) != 0) {
+        fprintf(stderr, "Unable to access the synthetic SD root\n");
+        return EXIT_FAILURE;
+    }
+
+    emu::Initialize();
+    emu::mock::SetCallLatency(opts.latency_us * 1000);
+
+    fprintf(stderr, "Running benchmarks...\n");
+    RunTranslationBenchs(opts.lang_dir);
+    if(!icons.empty()) {
+        RunPngBenchs(icons);
+    }
+    RunPathBenchs(favorites);
+    RunFavoritesBenchs();
+    RunFolderBenchs(opts);
+    RunSearchBenchs();
+
+    emu::Exit();
+    fs::current_path("/");
+    fs::remove_all(sd_root);
+
+    const auto results = MakeResultsJson(opts).dump(4);
+    if(!opts.output_path.empty()) {
+        std::ofstream ofs(opts.output_path);
+        ofs << results << std::endl;
+    }
+    std::cout << results << std::endl;
+    return EXIT_SUCCESS;
+}
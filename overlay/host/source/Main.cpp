@@ -0,0 +1,69 @@
+#include <emu/emu_MockService.hpp>
+#include <app/app_Favorites.hpp>
+#include <app/app_Folder.hpp>
+#include <app/app_Paths.hpp>
+#include <tr/tr_Translation.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+// Host driver for the overlay's data paths: lists a folder the same way AmiiboGui does, against the mock emuiibo service
+// The SD root must contain a "sdmc:" directory, so that the hardcoded "sdmc:/..." paths resolve relative to it
+
+namespace {
+
+    void PrintUsage(const char *self) {
+        fprintf(stderr, "Usage: %s <sd-root> [folder] [call-latency-us]\n", self);
+        fprintf(stderr, "  <sd-root> must contain a 'sdmc:' directory with the emuiibo tree inside\n");
+    }
+
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if(chdir(argv[1]) != 0) {
+        fprintf(stderr, "Unable to access SD root '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if(argc > 3) {
+        emu::mock::SetCallLatency(strtoull(argv[3], nullptr, 10) * 1000);
+    }
+
+    if(!tr::Load()) {
+        fprintf(stderr, "Unable to load translations, untranslated strings will be shown\n");
+    }
+    emu::Initialize();
+
+    char virtual_amiibo_dir[FS_MAX_PATH] = {};
+    emu::GetVirtualAmiiboDirectory(virtual_amiibo_dir, sizeof(virtual_amiibo_dir));
+    const std::string folder = (argc > 2) ? argv[2] : virtual_amiibo_dir;
+
+    app::LoadFavorites();
+    emu::mock::ResetCallCount();
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto entries = app::ClassifyEntries(app::ListDirectories(folder));
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    size_t virtual_amiibo_count = 0;
+    for(const auto &entry: entries) {
+        if(entry.is_virtual_amiibo) {
+            virtual_amiibo_count++;
+            printf("[amiibo] %s -> '%s'%s\n", app::GetPathFileName(entry.path).c_str(), entry.virtual_amiibo.name, app::IsFavorite(entry.path) ? " (favorite)" : "");
+        }
+        else {
+            printf("[folder] %s\n", app::GetPathFileName(entry.path).c_str());
+        }
+    }
+
+    printf("%s '%s': %zu (%zu entries, %llu service calls, %lld us)\n", "AvailableVirtualAmiibos"_tr.c_str(), app::GetPathFileName(folder).c_str(), virtual_amiibo_count, entries.size(), (unsigned long long)emu::mock::GetCallCount(), (long long)elapsed.count());
+
+    emu::Exit();
+    return EXIT_SUCCESS;
+}
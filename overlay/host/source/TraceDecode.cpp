@@ -0,0 +1,237 @@
+#include <switch.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Decoder for emuiibo's NFP command traces (sdmc:/emuiibo/trace.bin, recorded with the "trace" flag, see emuiibo's trace.rs)
+// Prints per-application, per-command latency stats and histograms
+
+namespace {
+
+    constexpr u32 TraceMagic = 0x43525445; // "ETRC"
+    constexpr u16 TraceVersion = 1;
+
+    struct TraceHeader {
+        u32 magic;
+        u16 version;
+        u16 entry_size;
+        u64 tick_frequency;
+        u32 entry_count;
+        u32 dropped_count;
+    };
+    static_assert(sizeof(TraceHeader) == 0x18);
+
+    struct TraceEntry {
+        u64 application_id;
+        u64 start_tick;
+        u64 end_tick;
+        u16 command_id;
+        u8 interface;
+        u8 handled;
+        u32 result;
+    };
+    static_assert(sizeof(TraceEntry) == 0x20);
+
+    enum class TraceInterface : u8 {
+        User,
+        System
+    };
+
+    // Histogram buckets: [0, 1us), [1us, 2us), [2us, 4us)... the last one holds everything above
+    constexpr size_t BucketCount = 24;
+    constexpr size_t HistogramBarWidth = 40;
+
+    struct CommandStats {
+        std::vector<double> latencies_us;
+        size_t forwarded_count = 0;
+        size_t error_count = 0;
+        size_t buckets[BucketCount] = {};
+    };
+
+    using CommandKey = std::tuple<u64, u8, u16>;
+
+    const char *GetCommandName(const TraceInterface interface, const u16 command_id) {
+        switch(command_id) {
+            case 0: return (interface == TraceInterface::User) ? "Initialize" : "InitializeSystem";
+            case 1: return (interface == TraceInterface::User) ? "Finalize" : "FinalizeSystem";
+            case 2: return "ListDevices";
+            case 3: return "StartDetection";
+            case 4: return "StopDetection";
+            case 5: return "Mount";
+            case 6: return "Unmount";
+            case 7: return "OpenApplicationArea";
+            case 8: return "GetApplicationArea";
+            case 9: return "SetApplicationArea";
+            case 10: return "Flush";
+            case 11: return "Restore";
+            case 12: return "CreateApplicationArea";
+            case 13: return "GetTagInfo";
+            case 14: return "GetRegisterInfo";
+            case 15: return "GetCommonInfo";
+            case 16: return "GetModelInfo";
+            case 17: return "AttachActivateEvent";
+            case 18: return "AttachDeactivateEvent";
+            case 19: return "GetState";
+            case 20: return "GetDeviceState";
+            case 21: return "GetNpadId";
+            case 22: return "GetApplicationAreaSize";
+            case 23: return "AttachAvailabilityChangeEvent";
+            case 24: return "RecreateApplicationArea";
+            case 100: return "Format";
+            case 101: return "GetAdminInfo";
+            case 102: return "GetRegisterInfoPrivate";
+            case 103: return "SetRegisterInfoPrivate";
+            case 104: return "DeleteRegisterInfo";
+            case 105: return "DeleteApplicationArea";
+            case 106: return "ExistsApplicationArea";
+            default: return nullptr;
+        }
+    }
+
+    std::string FormatCommand(const u8 interface, const u16 command_id) {
+        const auto trace_interface = static_cast<TraceInterface>(interface);
+        const auto interface_name = (trace_interface == TraceInterface::User) ? "user" : "sys";
+        const auto name = GetCommandName(trace_interface, command_id);
+        char buf[0x80] = {};
+        if(name != nullptr) {
+            snprintf(buf, sizeof(buf), "%s:%s (%u)", interface_name, name, command_id);
+        }
+        else {
+            snprintf(buf, sizeof(buf), "%s:%u", interface_name, command_id);
+        }
+        return buf;
+    }
+
+    size_t GetBucketIndex(const double latency_us) {
+        size_t idx = 0;
+        for(double upper = 1.0; (latency_us >= upper) && (idx < BucketCount - 1); upper *= 2.0) {
+            idx++;
+        }
+        return idx;
+    }
+
+    double GetPercentile(const std::vector<double> &sorted_latencies_us, const double percentile) {
+        const auto idx = static_cast<size_t>(percentile * (sorted_latencies_us.size() - 1) + 0.5);
+        return sorted_latencies_us[idx];
+    }
+
+    void PrintHistogram(const CommandStats &stats) {
+        size_t first = BucketCount;
+        size_t last = 0;
+        size_t max_count = 0;
+        for(size_t i = 0; i < BucketCount; i++) {
+            if(stats.buckets[i] > 0) {
+                first = std::min(first, i);
+                last = i;
+                max_count = std::max(max_count, stats.buckets[i]);
+            }
+        }
+
+        for(size_t i = first; i <= last; i++) {
+            char range[0x40] = {};
+            if(i == 0) {
+                snprintf(range, sizeof(range), "< 1us");
+            }
+            else if(i == BucketCount - 1) {
+                snprintf(range, sizeof(range), ">= %lluus", 1ull << (i - 1));
+            }
+            else {
+                snprintf(range, sizeof(range), "%llu-%lluus", 1ull << (i - 1), 1ull << i);
+            }
+
+            const auto bar_len = (stats.buckets[i] * HistogramBarWidth + max_count - 1) / max_count;
+            printf("      %14s | %-*s %zu\n", range, static_cast<int>(HistogramBarWidth), std::string(bar_len, '#').c_str(), stats.buckets[i]);
+        }
+    }
+
+    void PrintUsage(const char *self) {
+        fprintf(stderr, "Usage: %s <trace.bin> [application-id]\n", self);
+    }
+
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const bool filter_app = argc > 2;
+    const u64 filter_app_id = filter_app ? strtoull(argv[2], nullptr, 16) : 0;
+
+    std::ifstream trace_file(argv[1], std::ios::binary);
+    if(!trace_file) {
+        fprintf(stderr, "Unable to open trace '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    TraceHeader header = {};
+    if(!trace_file.read(reinterpret_cast<char*>(&header), sizeof(header)) || (header.magic != TraceMagic) || (header.version != TraceVersion) || (header.entry_size != sizeof(TraceEntry)) || (header.tick_frequency == 0)) {
+        fprintf(stderr, "Invalid trace '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<TraceEntry> entries(header.entry_count);
+    if(!trace_file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(TraceEntry))) {
+        fprintf(stderr, "Truncated trace '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::map<CommandKey, CommandStats> all_stats;
+    for(const auto &entry: entries) {
+        if(filter_app && (entry.application_id != filter_app_id)) {
+            continue;
+        }
+
+        auto &stats = all_stats[{ entry.application_id, entry.interface, entry.command_id }];
+        if(!entry.handled) {
+            stats.forwarded_count++;
+            continue;
+        }
+        if(entry.result != 0) {
+            stats.error_count++;
+        }
+
+        const auto latency_us = static_cast<double>(entry.end_tick - entry.start_tick) * 1000000.0 / static_cast<double>(header.tick_frequency);
+        stats.latencies_us.push_back(latency_us);
+        stats.buckets[GetBucketIndex(latency_us)]++;
+    }
+
+    printf("%u commands recorded (%u older ones dropped), tick frequency %llu Hz\n", header.entry_count, header.dropped_count, static_cast<unsigned long long>(header.tick_frequency));
+
+    u64 cur_app_id = 0;
+    bool first_app = true;
+    for(auto &[key, stats]: all_stats) {
+        const auto &[app_id, interface, command_id] = key;
+        if(first_app || (app_id != cur_app_id)) {
+            printf("\nApplication %016llX\n", static_cast<unsigned long long>(app_id));
+            cur_app_id = app_id;
+            first_app = false;
+        }
+
+        printf("  %s: %zu calls", FormatCommand(interface, command_id).c_str(), stats.latencies_us.size());
+        if(stats.error_count > 0) {
+            printf(", %zu failed", stats.error_count);
+        }
+        if(stats.forwarded_count > 0) {
+            printf(", %zu forwarded", stats.forwarded_count);
+        }
+
+        if(stats.latencies_us.empty()) {
+            printf("\n");
+            continue;
+        }
+
+        std::sort(stats.latencies_us.begin(), stats.latencies_us.end());
+        printf(" -- min %.1fus, p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n", stats.latencies_us.front(), GetPercentile(stats.latencies_us, 0.5), GetPercentile(stats.latencies_us, 0.9), GetPercentile(stats.latencies_us, 0.99), stats.latencies_us.back());
+        PrintHistogram(stats);
+    }
+
+    return EXIT_SUCCESS;
+}
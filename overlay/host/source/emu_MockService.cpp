@@ -0,0 +1,349 @@
+#include <emu/emu_MockService.hpp>
+#include <tr/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+// In-process replacement of source/emu/emu_Service.cpp: same API, but backed by the emuiibo/amiibo tree on disk instead of IPC
+
+namespace emu {
+
+    namespace {
+
+        constexpr auto VirtualAmiiboDirectory = "sdmc:/emuiibo/amiibo";
+
+        // Mirrors emuiibo's rc.rs values
+        constexpr u32 ResultModule = 352;
+        constexpr Result ResultVirtualAmiiboFlagNotFound = MAKERESULT(ResultModule, 1);
+        constexpr Result ResultInvalidJsonDeserialization = MAKERESULT(ResultModule, 4);
+        constexpr Result ResultInvalidLoadedVirtualAmiibo = MAKERESULT(ResultModule, 5);
+        constexpr Result ResultInvalidActiveVirtualAmiibo = MAKERESULT(ResultModule, 7);
+        constexpr Result ResultInvalidVirtualAmiiboAccessId = MAKERESULT(ResultModule, 8);
+        constexpr Result ResultAccessIdNotCached = MAKERESULT(ResultModule, 9);
+
+        std::atomic<u64> g_CallLatency = 0;
+        std::atomic<u64> g_CallCount = 0;
+
+        std::mutex g_StateLock;
+        EmulationStatus g_EmulationStatus = EmulationStatus::Off;
+        VirtualAmiiboStatus g_ActiveVirtualAmiiboStatus = VirtualAmiiboStatus::Invalid;
+        std::string g_ActiveVirtualAmiiboPath;
+        VirtualAmiiboData g_ActiveVirtualAmiiboData;
+        std::vector<VirtualAmiiboAreaEntry> g_ActiveVirtualAmiiboAreas;
+        u32 g_ActiveVirtualAmiiboCurrentAreaAccessId = 0;
+
+        inline void EmulateCall() {
+            g_CallCount++;
+            const auto latency = g_CallLatency.load();
+            if(latency > 0) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(latency));
+            }
+        }
+
+        inline bool ExistsFile(const std::string &path) {
+            struct stat st;
+            return (stat(path.c_str(), &st) == 0) && S_ISREG(st.st_mode);
+        }
+
+        inline void ReadDate(const nlohmann::json &date_json, VirtualAmiiboDate &out_date) {
+            out_date.year = date_json.value("y", 0);
+            out_date.month = date_json.value("m", 0);
+            out_date.day = date_json.value("d", 0);
+        }
+
+        Result ParseVirtualAmiibo(const std::string &path, VirtualAmiiboData &out_data) {
+            if(!ExistsFile(path + "/amiibo.flag")) {
+                return ResultVirtualAmiiboFlagNotFound;
+            }
+
+            try {
+                std::ifstream ifs(path + "/amiibo.json");
+                const auto amiibo_json = nlohmann::json::parse(ifs);
+
+                out_data = {};
+                const auto name = amiibo_json.value("name", std::string());
+                strncpy(out_data.name, name.c_str(), sizeof(out_data.name) - 1);
+                out_data.uuid_info.use_random_uuid = amiibo_json.value("use_random_uuid", false);
+                if(amiibo_json.count("uuid")) {
+                    const auto uuid = amiibo_json["uuid"].get<std::vector<u8>>();
+                    memcpy(out_data.uuid_info.uuid, uuid.data(), std::min(uuid.size(), sizeof(out_data.uuid_info.uuid)));
+                }
+                if(amiibo_json.count("first_write_date")) {
+                    ReadDate(amiibo_json["first_write_date"], out_data.first_write_date);
+                }
+                if(amiibo_json.count("last_write_date")) {
+                    ReadDate(amiibo_json["last_write_date"], out_data.last_write_date);
+                }
+
+                const auto mii_charinfo_file = amiibo_json.value("mii_charinfo_file", std::string());
+                if(!mii_charinfo_file.empty()) {
+                    std::ifstream mii_ifs(path + "/" + mii_charinfo_file, std::ios::binary);
+                    mii_ifs.read(reinterpret_cast<char*>(&out_data.mii_charinfo), sizeof(out_data.mii_charinfo));
+                }
+            }
+            catch(std::exception&) {
+                return ResultInvalidJsonDeserialization;
+            }
+
+            return out_data.IsValid() ? 0 : ResultInvalidJsonDeserialization;
+        }
+
+        Result ProbeVirtualAmiiboImpl(const std::string &path, VirtualAmiiboProbeData &out_data) {
+            if(!ExistsFile(path + "/amiibo.flag")) {
+                return ResultVirtualAmiiboFlagNotFound;
+            }
+
+            try {
+                std::ifstream ifs(path + "/amiibo.json");
+                const auto amiibo_json = nlohmann::json::parse(ifs);
+
+                out_data = {};
+                const auto name = amiibo_json.at("name").get<std::string>();
+                if(name.empty()) {
+                    return ResultInvalidLoadedVirtualAmiibo;
+                }
+                strncpy(out_data.name, name.c_str(), sizeof(out_data.name) - 1);
+
+                const auto &id_json = amiibo_json.at("id");
+                out_data.game_character_id = id_json.at("game_character_id").get<u16>();
+                out_data.character_variant = id_json.at("character_variant").get<u8>();
+                out_data.figure_type = id_json.at("figure_type").get<u8>();
+                out_data.model_number = id_json.at("model_number").get<u16>();
+                out_data.series = id_json.at("series").get<u8>();
+            }
+            catch(std::exception&) {
+                return ResultInvalidJsonDeserialization;
+            }
+
+            return 0;
+        }
+
+        void LoadAreas(const std::string &path) {
+            g_ActiveVirtualAmiiboAreas.clear();
+            g_ActiveVirtualAmiiboCurrentAreaAccessId = 0;
+            try {
+                std::ifstream ifs(path + "/areas.json");
+                const auto areas_json = nlohmann::json::parse(ifs);
+                if(areas_json.count("areas")) {
+                    for(const auto &area: areas_json["areas"]) {
+                        g_ActiveVirtualAmiiboAreas.push_back({ area.value("program_id", u64(0)), area.value("access_id", u32(0)) });
+                    }
+                }
+                g_ActiveVirtualAmiiboCurrentAreaAccessId = areas_json.value("current_area_access_id", u32(0));
+            }
+            catch(std::exception&) {}
+        }
+
+        inline bool HasActiveVirtualAmiibo() {
+            return !g_ActiveVirtualAmiiboPath.empty();
+        }
+
+    }
+
+    namespace mock {
+
+        void SetCallLatency(const u64 latency_ns) {
+            g_CallLatency = latency_ns;
+        }
+
+        u64 GetCallCount() {
+            return g_CallCount;
+        }
+
+        void ResetCallCount() {
+            g_CallCount = 0;
+        }
+
+    }
+
+    bool IsAvailable() {
+        EmulateCall();
+        return true;
+    }
+
+    Result Initialize() {
+        return 0;
+    }
+
+    void Exit() {}
+
+    Version GetVersion() {
+        EmulateCall();
+        return { VER_MAJOR, VER_MINOR, VER_MICRO, true };
+    }
+
+    void GetVirtualAmiiboDirectory(char *out_path, const size_t out_path_size) {
+        EmulateCall();
+        strncpy(out_path, VirtualAmiiboDirectory, out_path_size);
+        out_path[out_path_size - 1] = '\0';
+    }
+
+    EmulationStatus GetEmulationStatus() {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        return g_EmulationStatus;
+    }
+
+    void SetEmulationStatus(const EmulationStatus status) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        g_EmulationStatus = status;
+    }
+
+    Result GetActiveVirtualAmiibo(VirtualAmiiboData *out_amiibo_data, char *out_path, const size_t out_path_size) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(!HasActiveVirtualAmiibo()) {
+            return ResultInvalidActiveVirtualAmiibo;
+        }
+
+        *out_amiibo_data = g_ActiveVirtualAmiiboData;
+        strncpy(out_path, g_ActiveVirtualAmiiboPath.c_str(), out_path_size);
+        out_path[out_path_size - 1] = '\0';
+        return 0;
+    }
+
+    Result SetActiveVirtualAmiibo(const char *path, const size_t path_size) {
+        EmulateCall();
+        const std::string amiibo_path(path, strnlen(path, path_size));
+        VirtualAmiiboData data;
+        const auto rc = ParseVirtualAmiibo(amiibo_path, data);
+        if(R_FAILED(rc)) {
+            return rc;
+        }
+
+        std::scoped_lock lk(g_StateLock);
+        g_ActiveVirtualAmiiboPath = amiibo_path;
+        g_ActiveVirtualAmiiboData = data;
+        g_ActiveVirtualAmiiboStatus = VirtualAmiiboStatus::Connected;
+        LoadAreas(amiibo_path);
+        return 0;
+    }
+
+    void ResetActiveVirtualAmiibo() {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        g_ActiveVirtualAmiiboPath.clear();
+        g_ActiveVirtualAmiiboData = {};
+        g_ActiveVirtualAmiiboStatus = VirtualAmiiboStatus::Invalid;
+        g_ActiveVirtualAmiiboAreas.clear();
+        g_ActiveVirtualAmiiboCurrentAreaAccessId = 0;
+    }
+
+    VirtualAmiiboStatus GetActiveVirtualAmiiboStatus() {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        return g_ActiveVirtualAmiiboStatus;
+    }
+
+    void SetActiveVirtualAmiiboStatus(const VirtualAmiiboStatus status) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(HasActiveVirtualAmiibo()) {
+            g_ActiveVirtualAmiiboStatus = status;
+        }
+    }
+
+    bool IsApplicationIdIntercepted(const u64 app_id) {
+        EmulateCall();
+        return false;
+    }
+
+    Result TryParseVirtualAmiibo(const char *path, const size_t path_size, VirtualAmiiboData *out_amiibo_data) {
+        EmulateCall();
+        return ParseVirtualAmiibo(std::string(path, strnlen(path, path_size)), *out_amiibo_data);
+    }
+
+    Result GetActiveVirtualAmiiboAreas(VirtualAmiiboAreaEntry *out_area_buf, const size_t out_area_size, u32 *out_area_count) {
+        return GetActiveVirtualAmiiboAreasFrom(0, out_area_buf, out_area_size, out_area_count);
+    }
+
+    Result GetActiveVirtualAmiiboCurrentArea(u32 *out_access_id) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(!HasActiveVirtualAmiibo()) {
+            return ResultInvalidActiveVirtualAmiibo;
+        }
+
+        *out_access_id = g_ActiveVirtualAmiiboCurrentAreaAccessId;
+        return 0;
+    }
+
+    Result SetActiveVirtualAmiiboCurrentArea(const u32 access_id) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(!HasActiveVirtualAmiibo()) {
+            return ResultInvalidActiveVirtualAmiibo;
+        }
+
+        for(const auto &area: g_ActiveVirtualAmiiboAreas) {
+            if(area.access_id == access_id) {
+                g_ActiveVirtualAmiiboCurrentAreaAccessId = access_id;
+                return 0;
+            }
+        }
+        return ResultInvalidVirtualAmiiboAccessId;
+    }
+
+    Result SetActiveVirtualAmiiboUuidInfo(const VirtualAmiiboUuidInfo uuid_info) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(!HasActiveVirtualAmiibo()) {
+            return ResultInvalidActiveVirtualAmiibo;
+        }
+
+        g_ActiveVirtualAmiiboData.uuid_info = uuid_info;
+        return 0;
+    }
+
+    Result GetActiveVirtualAmiiboAreaCount(u32 *out_area_count) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(!HasActiveVirtualAmiibo()) {
+            return ResultInvalidActiveVirtualAmiibo;
+        }
+
+        *out_area_count = g_ActiveVirtualAmiiboAreas.size();
+        return 0;
+    }
+
+    Result GetActiveVirtualAmiiboAreasFrom(const u32 offset, VirtualAmiiboAreaEntry *out_area_buf, const size_t out_area_size, u32 *out_area_count) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        if(!HasActiveVirtualAmiibo()) {
+            return ResultInvalidActiveVirtualAmiibo;
+        }
+
+        const size_t max_count = out_area_size / sizeof(VirtualAmiiboAreaEntry);
+        u32 count = 0;
+        for(size_t i = offset; (i < g_ActiveVirtualAmiiboAreas.size()) && (count < max_count); i++) {
+            out_area_buf[count++] = g_ActiveVirtualAmiiboAreas[i];
+        }
+        *out_area_count = count;
+        return 0;
+    }
+
+    Result ProbeVirtualAmiibo(const char *path, const size_t path_size, VirtualAmiiboProbeData *out_probe_data) {
+        EmulateCall();
+        return ProbeVirtualAmiiboImpl(std::string(path, strnlen(path, path_size)), *out_probe_data);
+    }
+
+    Result GetCachedAccessId(const u64 program_id, u32 *out_access_id) {
+        EmulateCall();
+        std::scoped_lock lk(g_StateLock);
+        // No persistent cache here, the active virtual amiibo's areas are the only ones known
+        for(const auto &area: g_ActiveVirtualAmiiboAreas) {
+            if(area.program_id == program_id) {
+                *out_access_id = area.access_id;
+                return 0;
+            }
+        }
+        return ResultAccessIdNotCached;
+    }
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <emu/emu_Service.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace app {
+
+    class AreaTable {
+        private:
+            struct Area {
+                emu::VirtualAmiiboAreaEntry entry;
+                u32 title_offset;
+                u16 title_length;
+                bool title_resolved;
+            };
+
+            std::vector<Area> areas;
+            // All titles live in a single shared buffer, areas only keep their offset/length inside it
+            std::string title_arena;
+
+            void SetTitle(Area &area, const std::string_view &title);
+
+        public:
+            inline void Clear() {
+                this->areas.clear();
+                this->title_arena.clear();
+            }
+
+            // Fetches every area of the active virtual amiibo, page by page
+            Result LoadActiveVirtualAmiiboAreas();
+
+            inline u32 GetCount() const {
+                return this->areas.size();
+            }
+
+            inline bool IsEmpty() const {
+                return this->areas.empty();
+            }
+
+            inline const emu::VirtualAmiiboAreaEntry &GetEntry(const u32 idx) const {
+                return this->areas.at(idx).entry;
+            }
+
+            bool FindByAccessId(const u32 access_id, u32 &out_idx) const;
+
+            // Shows the hex access/program IDs until the actual title gets resolved in the background
+            std::string_view GetTitle(const u32 idx);
+    };
+
+}
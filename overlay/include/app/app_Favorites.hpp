@@ -0,0 +1,37 @@
+#pragma once
+#include <switch.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace app {
+
+    // What the favorites view shows for each favorite, persisted so that opening it doesn't need to probe every favorite again
+    struct FavoriteDisplayData {
+        bool is_virtual_amiibo;
+        std::string name;
+        // Latest modification time of the directory and its amiibo.json, when the data was probed
+        u64 stamp;
+    };
+
+    using FavoriteChangedCallback = std::function<void(const std::string&, const FavoriteDisplayData&)>;
+
+    void LoadFavorites();
+    void SaveFavorites();
+
+    void AddFavorite(const std::string &path);
+    void RemoveFavorite(const std::string &path);
+    bool IsFavorite(const std::string &path);
+
+    const std::vector<std::string> &GetFavorites();
+
+    // Probes the favorites which aren't cached yet, then returns every favorite (sorted) with its cached data
+    std::vector<std::pair<std::string, FavoriteDisplayData>> GetFavoritesDisplayData();
+
+    // Starts checking every favorite's stamp again, see RevalidateFavorites
+    void StartFavoritesRevalidation();
+    // Checks the stamps of up to the given amount of pending favorites, re-probing the ones which changed
+    // Meant to be called every frame, so that the checks never block the UI for long
+    void RevalidateFavorites(const size_t max_count, FavoriteChangedCallback on_changed);
+
+}
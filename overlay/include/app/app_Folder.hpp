@@ -0,0 +1,26 @@
+#pragma once
+#include <emu/emu_Service.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace app {
+
+    struct FolderEntry {
+        std::string path;
+        bool is_virtual_amiibo;
+        emu::VirtualAmiiboProbeData virtual_amiibo;
+    };
+
+    using FolderEntryCallback = std::function<void(FolderEntry&&)>;
+
+    std::vector<std::string> ListDirectories(const std::string &path);
+
+    // Sorts the given paths and tells virtual amiibos apart from regular folders
+    // Entries are classified on a small worker pool, but handed to the callback (on the calling thread) in sorted order, as soon as every previous one is done
+    // The SD card is kept open during the whole scan, so the callback must not open it again itself
+    void ScanEntries(std::vector<std::string> paths, FolderEntryCallback on_entry);
+
+    std::vector<FolderEntry> ClassifyEntries(std::vector<std::string> paths);
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace app {
+
+    inline std::string GetPathFileName(const std::string &path) {
+        return path.substr(path.find_last_of("/") + 1);
+    }
+
+    inline std::string GetBaseDirectory(const std::string &path) {
+        return path.substr(0, path.find_last_of("/"));
+    }
+
+    std::vector<std::string> SplitPath(const std::string &path);
+    std::string GetRelativePathTo(const std::string &ref_path, const std::string &in_path);
+
+}
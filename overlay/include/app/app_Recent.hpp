@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace app {
+
+    struct RecentEntry {
+        std::string path;
+        std::string name;
+    };
+
+    void LoadRecent();
+    void SaveRecent();
+
+    // Moves (or adds) the virtual amiibo to the front, dropping the oldest one when full
+    void PushRecent(const std::string &path, const std::string &name);
+    void RemoveRecent(const std::string &path);
+
+    // Most recent first
+    std::vector<RecentEntry> GetRecent();
+
+}
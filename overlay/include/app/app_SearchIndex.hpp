@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace app {
+
+    struct SearchIndexEntry {
+        std::string path;
+        std::string name;
+    };
+
+    // The index covers every virtual amiibo under the given root, persisted between runs so that searching doesn't need a full scan each time
+    void LoadSearchIndex(const std::string &root_path);
+    void SaveSearchIndex();
+
+    // False until the index was either loaded or rebuilt once
+    bool IsSearchIndexBuilt();
+
+    // Full recursive scan of the root (same classification as folder listings)
+    void RebuildSearchIndex();
+
+    // Replaces the indexed virtual amiibos directly inside the given folder, so that browsing keeps the index up to date for free
+    void UpdateSearchIndexDirectory(const std::string &dir_path, std::vector<SearchIndexEntry> entries);
+
+    size_t GetSearchIndexEntryCount();
+
+    // Case-insensitive substring match over names and paths (relative to the root), names starting with the query come first
+    std::vector<const SearchIndexEntry*> Search(const std::string &query, const size_t max_results);
+
+}
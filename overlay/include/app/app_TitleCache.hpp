@@ -0,0 +1,16 @@
+#pragma once
+#include <switch.h>
+#include <string>
+
+namespace app {
+
+    void LoadTitleCache();
+    void SaveTitleCache();
+
+    void StartTitleResolver();
+    void StopTitleResolver();
+
+    // Never blocks: on a cache miss the title is queued to be resolved in the background, and false is returned until it is available
+    bool TryGetApplicationTitle(const u64 program_id, std::string &out_title);
+
+}
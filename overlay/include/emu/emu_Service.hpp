@@ -28,6 +28,15 @@ namespace emu {
         }
     };
 
+    struct VirtualAmiiboProbeData {
+        char name[40 + 1];
+        u16 game_character_id;
+        u8 character_variant;
+        u8 figure_type;
+        u16 model_number;
+        u8 series;
+    };
+
     struct VirtualAmiiboAreaEntry {
         u64 program_id;
         u32 access_id;
@@ -93,5 +102,11 @@ namespace emu {
     Result GetActiveVirtualAmiiboCurrentArea(u32 *out_access_id);
     Result SetActiveVirtualAmiiboCurrentArea(const u32 access_id);
     Result SetActiveVirtualAmiiboUuidInfo(const VirtualAmiiboUuidInfo uuid_info);
+    Result GetActiveVirtualAmiiboAreaCount(u32 *out_area_count);
+    Result GetActiveVirtualAmiiboAreasFrom(const u32 offset, VirtualAmiiboAreaEntry *out_area_buf, const size_t out_area_size, u32 *out_area_count);
+    // Read-only, lightweight alternative to TryParseVirtualAmiibo (only name and ID), meant for listing directories
+    Result ProbeVirtualAmiibo(const char *path, const size_t path_size, VirtualAmiiboProbeData *out_probe_data);
+    // Access ID last used by the given application, kept in memory by emuiibo
+    Result GetCachedAccessId(const u64 program_id, u32 *out_access_id);
 
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <switch.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Per-frame profiler: named regions accumulate their time during a frame, and every frame's total is kept in a rolling history/histogram
+// Everything happens on the UI thread, and regions cost nothing while the profiler is disabled
+
+namespace ui::prof {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t HistoryFrameCount = 120;
+    // Bucket 0: < 8us, then doubling up to the last one, which holds everything from ~32ms
+    constexpr size_t BucketCount = 14;
+    constexpr u64 FirstBucketLimitNs = 8'000;
+
+    // Time between the start of consecutive frames
+    constexpr auto FrameRegionName = "frame";
+
+    struct RegionSummary {
+        const char *name;
+        double last_ms;
+        double avg_ms;
+        double max_ms;
+        // Only frames where the region was entered are counted
+        u32 bucket_counts[BucketCount];
+    };
+
+    bool IsEnabled();
+    // Also resets every region, so that the panel only shows fresh timings
+    void SetEnabled(const bool enabled);
+
+    // Closes the previous frame (pushing every region's time into its history) and starts a new one
+    void BeginFrame();
+
+    void AddRegionTime(const char *name, const u64 ns);
+
+    std::vector<RegionSummary> GetRegionSummaries();
+
+    // Region names are expected to be string literals, they are not copied
+    class ScopedRegion {
+        private:
+            const char *name;
+            Clock::time_point start;
+            bool active;
+
+        public:
+            ScopedRegion(const char *name) : name(name), active(IsEnabled()) {
+                if(this->active) {
+                    this->start = Clock::now();
+                }
+            }
+
+            ~ScopedRegion() {
+                if(this->active) {
+                    AddRegionTime(this->name, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - this->start).count());
+                }
+            }
+    };
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <tesla.hpp>
+#include <ui/ui_Profiler.hpp>
+#include <ui/ui_TextMeasure.hpp>
 
 #define SECTION_SAME_SIZE(height) ((height - 73 - 80) / 2)
 #define SECTION_BIG_SIZE(height) (((height - 73 - 80) / 3) * 2)
@@ -13,6 +15,7 @@ namespace ui {
     namespace style {
         namespace color {
             constexpr Color ColorWarning          = { 0xF, 0x7, 0x7, 0xF };   ///< Text red warning color
+            constexpr Color ColorProfilerPanel    = { 0x0, 0x0, 0x0, 0xD };   ///< Profiler panel background color
         }
     }
 
@@ -29,8 +32,14 @@ namespace ui {
             virtual ~BigCategoryHeader() {}
 
             virtual void draw(tsl::gfx::Renderer *renderer) override {
+                if (this->m_measuredText != this->m_text || this->m_measuredWidth != this->getWidth()) {
+                    this->m_displayText = text::LimitStringWidth(renderer, this->m_text, 20, this->getWidth() - 13);
+                    this->m_measuredText = this->m_text;
+                    this->m_measuredWidth = this->getWidth();
+                }
+
                 renderer->drawRect(this->getX() - 2, this->getBottomBound() - 50, 5, this->getHeight() - 30, a(tsl::style::color::ColorHeaderBar));
-                renderer->drawString(this->m_text.c_str(), false, this->getX() + 13, this->getBottomBound() - 24, 20, a(tsl::style::color::ColorText));
+                renderer->drawString(this->m_displayText.c_str(), false, this->getX() + 13, this->getBottomBound() - 24, 20, a(tsl::style::color::ColorText));
 
                 if (this->m_hasSeparator)
                     renderer->drawRect(this->getX(), this->getBottomBound() , this->getWidth(), 1, a(tsl::style::color::ColorFrame));
@@ -50,6 +59,9 @@ namespace ui {
 
         private:
             bool m_hasSeparator;
+            std::string m_displayText;
+            std::string m_measuredText;
+            u16 m_measuredWidth = 0;
         };
 
         class CustomCategoryHeader : public ListItem {
@@ -58,8 +70,14 @@ namespace ui {
             virtual ~CustomCategoryHeader() {}
 
             virtual void draw(tsl::gfx::Renderer *renderer) override {
+                if (this->m_measuredText != this->m_text || this->m_measuredWidth != this->getWidth()) {
+                    this->m_displayText = text::LimitStringWidth(renderer, this->m_text, 15, this->getWidth() - 13);
+                    this->m_measuredText = this->m_text;
+                    this->m_measuredWidth = this->getWidth();
+                }
+
                 renderer->drawRect(this->getX() - 2, this->getBottomBound() - 30, 5, 23, a(tsl::style::color::ColorHeaderBar));
-                renderer->drawString(this->m_text.c_str(), false, this->getX() + 13, this->getBottomBound() - 12, 15, a(tsl::style::color::ColorText));
+                renderer->drawString(this->m_displayText.c_str(), false, this->getX() + 13, this->getBottomBound() - 12, 15, a(tsl::style::color::ColorText));
 
                 if (this->m_hasSeparator)
                     renderer->drawRect(this->getX(), this->getBottomBound(), this->getWidth(), 1, a(tsl::style::color::ColorFrame));
@@ -88,6 +106,9 @@ namespace ui {
         private:
             bool m_hasSeparator;
             bool m_alwaysSmall;
+            std::string m_displayText;
+            std::string m_measuredText;
+            u16 m_measuredWidth = 0;
         };
 
         /**
@@ -112,22 +133,22 @@ namespace ui {
                 }
 
                 if (this->m_maxWidth == 0) {
+                    prof::ScopedRegion region("text_measure");
                     if (this->m_value.length() > 0) {
-                        auto [valueWidth, valueHeight] = renderer->drawString(this->m_value.c_str(), false, 0, 0, 15, tsl::style::color::ColorTransparent);
+                        const auto valueWidth = text::GetStringWidth(renderer, this->m_value, 15);
                         this->m_maxWidth = this->getWidth() - valueWidth - 70;
                     } else {
                         this->m_maxWidth = this->getWidth() - 40;
                     }
 
-                    auto [width, height] = renderer->drawString(this->m_text.c_str(), false, 0, 0, 15, tsl::style::color::ColorTransparent);
+                    const u32 width = text::GetStringWidth(renderer, this->m_text, 15);
                     this->m_trunctuated = width > this->m_maxWidth;
 
                     if (this->m_trunctuated) {
                         this->m_scrollText = this->m_text + "        ";
-                        auto [width, height] = renderer->drawString(this->m_scrollText.c_str(), false, 0, 0, 15, tsl::style::color::ColorTransparent);
+                        this->m_textWidth = text::GetStringWidth(renderer, this->m_scrollText, 15);
                         this->m_scrollText += this->m_text;
-                        this->m_textWidth = width;
-                        this->m_ellipsisText = renderer->limitStringLength(this->m_text, false, 15, this->m_maxWidth);
+                        this->m_ellipsisText = text::LimitStringWidth(renderer, this->m_text, 15, this->m_maxWidth);
                     } else {
                         this->m_textWidth = width;
                     }
@@ -358,6 +379,101 @@ namespace ui {
             std::function<void(bool)> m_stateChangedListener = [](bool){};
         };
 
+        /**
+         * @brief A list item to type text without a keyboard: left/right pick a character, A appends it, Y deletes the last one and X clears everything
+         *
+         */
+        class CharacterPickerListItem : public SmallListItem {
+        public:
+            /**
+             * @brief Constructor
+             *
+             * @param text Description text, the typed text is drawn after it
+             * @param characters Characters to pick from
+             */
+            CharacterPickerListItem(const std::string& text, const std::string& characters)
+                : SmallListItem(text), m_label(text), m_characters(characters) {
+
+                this->updateTexts();
+            }
+
+            virtual ~CharacterPickerListItem() {}
+
+            virtual bool onClick(u64 keys) override {
+                if (keys & HidNpadButton_AnyLeft) {
+                    this->m_selected = (this->m_selected + this->m_characters.length() - 1) % this->m_characters.length();
+                    this->updateTexts();
+                    return true;
+                }
+                if (keys & HidNpadButton_AnyRight) {
+                    this->m_selected = (this->m_selected + 1) % this->m_characters.length();
+                    this->updateTexts();
+                    return true;
+                }
+
+                const auto prev_typed = this->m_typed;
+                if (keys & HidNpadButton_A)
+                    this->m_typed += this->m_characters[this->m_selected];
+                else if ((keys & HidNpadButton_Y) && !this->m_typed.empty())
+                    this->m_typed.pop_back();
+                else if (keys & HidNpadButton_X)
+                    this->m_typed.clear();
+                else
+                    return SmallListItem::onClick(keys);
+
+                if (this->m_typed != prev_typed) {
+                    this->updateTexts();
+                    this->m_typedChangedListener(this->m_typed);
+                }
+                return true;
+            }
+
+            /**
+             * @brief Gets the typed text
+             *
+             * @return Text
+             */
+            inline const std::string& getTyped() const {
+                return this->m_typed;
+            }
+
+            /**
+             * @brief Adds a listener that gets called whenever the typed text changes
+             *
+             * @param typedChangedListener Listener with the typed text passed in as parameter
+             */
+            void setTypedChangedListener(std::function<void(const std::string&)> typedChangedListener) {
+                this->m_typedChangedListener = typedChangedListener;
+            }
+
+        protected:
+            static constexpr size_t VisibleNeighbours = 3;
+
+            void updateTexts() {
+                this->setText(this->m_label + ": " + this->m_typed + "_");
+
+                // The selected character and its neighbours on each side, wrapping around
+                const auto count = this->m_characters.length();
+                std::string picker;
+                for (size_t i = count - VisibleNeighbours; i <= count + VisibleNeighbours; i++) {
+                    const auto c = this->m_characters[(this->m_selected + i) % count];
+                    if (i == count)
+                        picker += std::string("[") + c + "] ";
+                    else
+                        picker += std::string(1, c) + " ";
+                }
+                picker.pop_back();
+                this->setValue(picker);
+            }
+
+            std::string m_label;
+            std::string m_characters;
+            std::string m_typed;
+            size_t m_selected = 0;
+
+            std::function<void(const std::string&)> m_typedChangedListener = [](const std::string&){};
+        };
+
         class DoubleSectionOverlayFrame : public Element {
         public:
             /**
@@ -377,6 +493,10 @@ namespace ui {
             }
 
             virtual void draw(tsl::gfx::Renderer *renderer) override {
+                // The frame is drawn once per frame, before anything else
+                prof::BeginFrame();
+                prof::ScopedRegion region("draw");
+
                 renderer->fillScreen(a(tsl::style::color::ColorFrameBackground));
                 renderer->drawRect(tsl::cfg::FramebufferWidth - 1, 0, 1, tsl::cfg::FramebufferHeight, a(0xF222));
 
@@ -406,6 +526,9 @@ namespace ui {
                     this->m_topSection->frame(renderer);
                 if (this->m_bottomSection != nullptr)
                     this->m_bottomSection->frame(renderer);
+
+                if (prof::IsEnabled())
+                    this->drawProfilerPanel(renderer);
             }
 
             virtual void layout(u16 parentX, u16 parentY, u16 parentWidth, u16 parentHeight) override {
@@ -528,6 +651,44 @@ namespace ui {
             }
 
         protected:
+            static constexpr s32 ProfilerLineHeight = 16;
+            static constexpr s32 ProfilerBarWidth = 4;
+
+            /**
+             * @brief Draws the profiler's timings (last, average and max per region) and histograms above the bottom bar
+             *
+             * @param renderer Renderer
+             */
+            void drawProfilerPanel(tsl::gfx::Renderer *renderer) {
+                const auto summaries = prof::GetRegionSummaries();
+                const s32 panelHeight = (summaries.size() + 1) * ProfilerLineHeight + 8;
+                const s32 panelY = tsl::cfg::FramebufferHeight - 73 - panelHeight;
+                const s32 barsX = tsl::cfg::FramebufferWidth - 25 - prof::BucketCount * ProfilerBarWidth;
+                renderer->drawRect(15, panelY, tsl::cfg::FramebufferWidth - 30, panelHeight, a(ui::style::color::ColorProfilerPanel));
+
+                s32 y = panelY + 4 + ProfilerLineHeight;
+                renderer->drawString("region        last    avg    max (ms)", true, 20, y - 3, 13, a(tsl::style::color::ColorDescription));
+                for (const auto &summary : summaries) {
+                    y += ProfilerLineHeight;
+                    char line[0x80] = {};
+                    snprintf(line, sizeof(line), "%-12.12s %6.2f %6.2f %6.2f", summary.name, summary.last_ms, summary.avg_ms, summary.max_ms);
+                    renderer->drawString(line, true, 20, y - 3, 13, a(tsl::style::color::ColorText));
+
+                    u32 maxCount = 0;
+                    for (const auto count : summary.bucket_counts)
+                        maxCount = std::max(maxCount, count);
+                    if (maxCount == 0)
+                        continue;
+
+                    // One bar per bucket, from < 8us on the left to >= 32ms on the right
+                    for (size_t i = 0; i < prof::BucketCount; i++) {
+                        const s32 barHeight = (summary.bucket_counts[i] * (ProfilerLineHeight - 4) + maxCount - 1) / maxCount;
+                        if (barHeight > 0)
+                            renderer->drawRect(barsX + i * ProfilerBarWidth, y - 2 - barHeight, ProfilerBarWidth - 1, barHeight, a(tsl::style::color::ColorHighlight));
+                    }
+                }
+            }
+
             Element *m_topSection = nullptr;
             Element *m_bottomSection = nullptr;
             std::string m_title, m_subtitle;
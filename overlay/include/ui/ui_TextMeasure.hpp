@@ -0,0 +1,116 @@
+#pragma once
+#include <tesla.hpp>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Text measuring without rasterising: libtesla only measures by drawing strings (with a transparent color), so every glyph's advance is measured once
+// and string widths are computed (and cached) from them. libtesla doesn't kern, so a string's width is the sum of its glyphs' advances
+
+namespace ui::text {
+
+    namespace impl {
+
+        // Recently measured strings are kept, the cache is simply dropped once it gets this big
+        constexpr size_t MaxCachedStringCount = 512;
+
+        struct FontSizeCache {
+            float font_size;
+            std::unordered_map<u32, s32> glyph_advances;
+            std::unordered_map<std::string, s32> string_widths;
+        };
+
+        inline std::vector<FontSizeCache> g_FontSizeCaches;
+
+        inline FontSizeCache &GetFontSizeCache(const float font_size) {
+            for(auto &cache: g_FontSizeCaches) {
+                if(cache.font_size == font_size) {
+                    return cache;
+                }
+            }
+            return g_FontSizeCaches.emplace_back(FontSizeCache{ font_size, {}, {} });
+        }
+
+        // Returns the byte length of the UTF-8 sequence at str (1 for invalid bytes, which are measured as they are)
+        inline size_t DecodeUtf8(const char *str, const size_t str_len, u32 &out_codepoint) {
+            const auto c = static_cast<u8>(str[0]);
+            size_t len = 1;
+            if((c & 0xE0) == 0xC0) {
+                len = 2;
+            }
+            else if((c & 0xF0) == 0xE0) {
+                len = 3;
+            }
+            else if((c & 0xF8) == 0xF0) {
+                len = 4;
+            }
+            if(len > str_len) {
+                len = 1;
+            }
+
+            out_codepoint = 0;
+            memcpy(&out_codepoint, str, len);
+            return len;
+        }
+
+        inline s32 GetGlyphAdvance(tsl::gfx::Renderer *renderer, FontSizeCache &cache, const char *glyph, const size_t glyph_len, const u32 codepoint) {
+            auto it = cache.glyph_advances.find(codepoint);
+            if(it == cache.glyph_advances.end()) {
+                const std::string glyph_str(glyph, glyph_len);
+                auto [width, height] = renderer->drawString(glyph_str.c_str(), false, 0, 0, cache.font_size, tsl::style::color::ColorTransparent);
+                it = cache.glyph_advances.emplace(codepoint, width).first;
+            }
+            return it->second;
+        }
+
+    }
+
+    // Width of the string as libtesla draws it, the renderer is only used to measure glyphs which weren't measured yet
+    inline s32 GetStringWidth(tsl::gfx::Renderer *renderer, const std::string &str, const float font_size) {
+        auto &cache = impl::GetFontSizeCache(font_size);
+        const auto it = cache.string_widths.find(str);
+        if(it != cache.string_widths.end()) {
+            return it->second;
+        }
+
+        s32 width = 0;
+        for(size_t i = 0; i < str.length();) {
+            u32 codepoint;
+            const auto len = impl::DecodeUtf8(str.c_str() + i, str.length() - i, codepoint);
+            width += impl::GetGlyphAdvance(renderer, cache, str.c_str() + i, len, codepoint);
+            i += len;
+        }
+
+        if(cache.string_widths.size() >= impl::MaxCachedStringCount) {
+            cache.string_widths.clear();
+        }
+        cache.string_widths.emplace(str, width);
+        return width;
+    }
+
+    // The string itself if it fits in the given width, otherwise cut with an ellipsis (same as libtesla's limitStringLength)
+    inline std::string LimitStringWidth(tsl::gfx::Renderer *renderer, const std::string &str, const float font_size, const s32 max_width) {
+        if(GetStringWidth(renderer, str, font_size) <= max_width) {
+            return str;
+        }
+
+        constexpr auto Ellipsis = "…";
+        auto &cache = impl::GetFontSizeCache(font_size);
+        const auto available_width = max_width - GetStringWidth(renderer, Ellipsis, font_size);
+        s32 width = 0;
+        size_t cut_len = 0;
+        for(size_t i = 0; i < str.length();) {
+            u32 codepoint;
+            const auto len = impl::DecodeUtf8(str.c_str() + i, str.length() - i, codepoint);
+            width += impl::GetGlyphAdvance(renderer, cache, str.c_str() + i, len, codepoint);
+            if(width > available_width) {
+                break;
+            }
+            i += len;
+            cut_len = i;
+        }
+        return str.substr(0, cut_len) + Ellipsis;
+    }
+
+}
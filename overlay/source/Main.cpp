@@ -5,10 +5,13 @@
 #include <emu/emu_Service.hpp>
 #include <ui/ui_PngImage.hpp>
 #include <tr/tr_Translation.hpp>
-#include <dirent.h>
-#include <fstream>
-#include <sstream>
-#include <iomanip>
+#include <app/app_TitleCache.hpp>
+#include <app/app_AreaTable.hpp>
+#include <app/app_Paths.hpp>
+#include <app/app_Favorites.hpp>
+#include <app/app_Recent.hpp>
+#include <app/app_Folder.hpp>
+#include <app/app_SearchIndex.hpp>
 
 namespace {
 
@@ -22,6 +25,8 @@ namespace {
     constexpr auto ActionKeyResetActiveVirtualAmiibo = HidNpadButton_Minus;
     constexpr auto ActionKeyEnableRandomUuid = HidNpadButton_ZR;
     constexpr auto ActionKeyDisableRandomUuid = HidNpadButton_ZL;
+    // Both sticks pressed together
+    constexpr auto ActionKeyComboToggleProfiler = HidNpadButton_StickL | HidNpadButton_StickR;
     
     inline std::string GetActionKeyGlyph(const u64 action_key) {
         for(const auto &info : tsl::impl::KEYS_INFO) {
@@ -40,13 +45,15 @@ namespace {
     enum class Icon {
         Help,
         Reset,
-        Favorite
+        Favorite,
+        RunningApplication
     };
 
     static const std::unordered_map<Icon, std::string> IconGlyphTable = {
         { Icon::Help, "\uE142" },
         { Icon::Reset, "\uE098" },
         { Icon::Favorite, "\u2605" },
+        { Icon::RunningApplication, "\u25B6" },
     };
 
     inline std::string GetIconGlyph(const Icon icon) {
@@ -72,23 +79,17 @@ namespace {
     // Defined in Makefile
     constexpr emu::Version ExpectedVersion = { VER_MAJOR, VER_MINOR, VER_MICRO, {} };
 
-    constexpr auto FavoritesFile = "sdmc:/emuiibo/overlay/favorites.txt";
-
     bool g_InitializationOk;
     std::string g_VirtualAmiiboDirectory;
     emu::Version g_Version;
     std::string g_ActiveVirtualAmiiboPath;
     emu::VirtualAmiiboData g_ActiveVirtualAmiiboData;
     ui::PngImage g_VirtualAmiiboImage;
-    std::vector<std::string> g_Favorites;
 
-    constexpr size_t MaxVirtualAmiiboAreaCount = 15;
-    u32 g_VirtualAmiiboAreaCount = 0;
+    app::AreaTable g_VirtualAmiiboAreas;
     u32 g_VirtualAmiiboCurrentAreaIndex = 0;
-    emu::VirtualAmiiboAreaEntry g_VirtualAmiiboAreaEntries[MaxVirtualAmiiboAreaCount];
-    std::string g_VirtualAmiiboAreaTitles[MaxVirtualAmiiboAreaCount];
-
-    NsApplicationControlData g_TempControlData;
+    bool g_HasRunningApplicationAccessId = false;
+    u32 g_RunningApplicationAccessId = 0;
 
     inline bool IsActiveVirtualAmiiboValid() {
         return !g_ActiveVirtualAmiiboPath.empty();
@@ -147,35 +148,22 @@ namespace {
         g_ActiveVirtualAmiiboPath.assign(active_virtual_amiibo_path_str);
 
         g_VirtualAmiiboImage.Reset();
+        g_VirtualAmiiboAreas.Clear();
+        g_VirtualAmiiboCurrentAreaIndex = 0;
         if(IsActiveVirtualAmiiboValid()) {
-            emu::GetActiveVirtualAmiiboAreas(g_VirtualAmiiboAreaEntries, sizeof(g_VirtualAmiiboAreaEntries), &g_VirtualAmiiboAreaCount);
-
-            for(u32 i = 0; i < g_VirtualAmiiboAreaCount; i++) {
-                const auto program_id = g_VirtualAmiiboAreaEntries[i].program_id;
-                const auto access_id = g_VirtualAmiiboAreaEntries[i].access_id;
-                std::stringstream strm;
-                strm << std::hex << std::uppercase << std::setfill('0') << "0x" << std::setw(0x8) << access_id << " (" << std::setw(0x10) << program_id << ")";
-                g_VirtualAmiiboAreaTitles[i] = strm.str();
-
-                if(R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_Storage, program_id, &g_TempControlData, sizeof(g_TempControlData), nullptr))) {
-                    tsl::hlp::doWithSmSession([&]() {
-                        NacpLanguageEntry *entry = nullptr;
-                        nacpGetLanguageEntry(&g_TempControlData.nacp, &entry);
-                        if(entry != nullptr) {
-                            g_VirtualAmiiboAreaTitles[i] = entry->name;
-                        }
-                    });
-                }
-            }
+            g_VirtualAmiiboAreas.LoadActiveVirtualAmiiboAreas();
 
             u32 cur_access_id;
             if(R_SUCCEEDED(emu::GetActiveVirtualAmiiboCurrentArea(&cur_access_id))) {
-                for(u32 i = 0; i < g_VirtualAmiiboAreaCount; i++) {
-                    if(g_VirtualAmiiboAreaEntries[i].access_id == cur_access_id) {
-                        g_VirtualAmiiboCurrentAreaIndex = i;
-                        break;
-                    }
-                }
+                g_VirtualAmiiboAreas.FindByAccessId(cur_access_id, g_VirtualAmiiboCurrentAreaIndex);
+            }
+
+            // emuiibo already knows which area the running game uses, so we can point it out
+            g_HasRunningApplicationAccessId = false;
+            u64 process_id = 0;
+            u64 program_id = 0;
+            if(R_SUCCEEDED(pmdmntGetApplicationProcessId(&process_id)) && R_SUCCEEDED(pmdmntGetProgramId(&program_id, process_id))) {
+                g_HasRunningApplicationAccessId = R_SUCCEEDED(emu::GetCachedAccessId(program_id, &g_RunningApplicationAccessId));
             }
 
             g_VirtualAmiiboImage.Load(g_ActiveVirtualAmiiboPath + "/amiibo.png", GetIconMaxWidth(), IconMaxHeight);
@@ -185,6 +173,14 @@ namespace {
     inline void SetActiveVirtualAmiibo(const std::string &path) {
         emu::SetActiveVirtualAmiibo(path.c_str(), path.size());
         LoadActiveVirtualAmiibo();
+
+        // The name comes with the active virtual amiibo's data, so the recent list never needs to parse anything itself
+        if(g_ActiveVirtualAmiiboPath == path) {
+            app::PushRecent(path, g_ActiveVirtualAmiiboData.name);
+        }
+        else {
+            app::RemoveRecent(path);
+        }
     }
 
     inline void ResetActiveVirtualAmiibo() {
@@ -192,76 +188,13 @@ namespace {
         LoadActiveVirtualAmiibo();
     }
 
-    inline void AddFavorite(const std::string &path) {
-        g_Favorites.push_back(path);
-    }
-
-    inline void RemoveFavorite(const std::string &path) {
-        g_Favorites.erase(std::remove(g_Favorites.begin(), g_Favorites.end(), path), g_Favorites.end()); 
-    }
-
-    inline bool IsFavorite(const std::string &path) {
-        return std::find(g_Favorites.begin(), g_Favorites.end(), path) != g_Favorites.end();
-    }
-
-    void LoadFavorites() {
-        g_Favorites.clear();
-        tsl::hlp::doWithSDCardHandle([&]() {
-            std::ifstream favs_file(FavoritesFile);
-            std::string fav_path_str;
-            while(std::getline(favs_file, fav_path_str)) {
-                AddFavorite(fav_path_str);
-            }
-        });
-    }
-
-    void SaveFavorites() {
-        tsl::hlp::doWithSDCardHandle([&]() {
-            std::ofstream file(FavoritesFile, std::ofstream::out | std::ofstream::trunc);
-            for(const auto &fav_path: g_Favorites) {
-                file << fav_path << std::endl;
-            }
-        });
-    }
-
-    inline std::string GetPathFileName(const std::string &path) {
-        return path.substr(path.find_last_of("/") + 1);
-    }
-
-    std::vector<std::string> SplitPath(const std::string &path) {
-        std::vector<std::string> items;
-        std::stringstream ss(path);
-        std::string item;
-        while(std::getline(ss, item, '/')) {
-            items.push_back(item);
-        }
-        return items;
-    }
-
-    inline std::string GetRelativePathTo(const std::string &ref_path, const std::string &in_path) {
-        const auto ref_path_items = SplitPath(ref_path);
-        const auto in_path_items = SplitPath(in_path);
-        u32 i = 0;
-        std::string rel_path;
-        for(; i < ref_path_items.size(); i++) {
-            const auto cur_ref_path_item = ref_path_items.at(i);
-            const auto cur_in_path_item = in_path_items.at(i);
-            if(cur_ref_path_item != cur_in_path_item) {
-                rel_path += "../";
-            }
-        }
-        
-        for(u32 j = i; j < in_path_items.size(); j++) {
-            rel_path += in_path_items.at(j) + '/';
+    inline void SelectVirtualAmiibo(const std::string &path) {
+        if(g_ActiveVirtualAmiiboPath != path) {
+            SetActiveVirtualAmiibo(path);
         }
-        if(!rel_path.empty()) {
-            rel_path.pop_back();
+        else {
+            ToggleActiveVirtualAmiiboStatus();
         }
-        return rel_path;
-    }
-
-    inline std::string GetBaseDirectory(const std::string &path) {
-        return path.substr(0, path.find_last_of("/"));
     }
 
 }
@@ -290,18 +223,18 @@ class GuiListElement: public ui::elm::SmallListItem {
         }
 
         inline bool IsFavorite() const {
-            return ::IsFavorite(this->path);
+            return app::IsFavorite(this->path);
         }
 
         inline void AddFavorite() {
             if(this->CanBeFavorite()) {
-                ::AddFavorite(this->path);
+                app::AddFavorite(this->path);
                 this->Update();
             }
         }
 
         inline void RemoveFavorite() {
-            ::RemoveFavorite(this->path);
+            app::RemoveFavorite(this->path);
             this->Update();
         }
 
@@ -338,7 +271,7 @@ class FolderListElement: public GuiListElement {
         }
     
     public:
-        FolderListElement(const std::string &path) : GuiListElement(path, GetPathFileName(path)) {
+        FolderListElement(const std::string &path) : GuiListElement(path, app::GetPathFileName(path)) {
             this->Update();
         }
 };
@@ -355,7 +288,7 @@ class AmiiboListElement: public GuiListElement {
         }
     
     public:
-        AmiiboListElement(const std::string &path, const emu::VirtualAmiiboData &data) : GuiListElement(path, data.name) {
+        AmiiboListElement(const std::string &path, const std::string &name) : GuiListElement(path, name) {
             this->Update();
         }
 };
@@ -408,6 +341,7 @@ class AmiiboIcons: public tsl::elm::Element {
 
     private:
         void DrawIcon(tsl::gfx::Renderer* renderer, const s32 x, const s32 y, const s32 w, const s32 h, const ui::PngImage &image) {
+            ui::prof::ScopedRegion region("icon_blit");
             const auto img_buf = image.GetRGBABuffer();
             if(img_buf != nullptr) {
                 renderer->drawBitmap(x + IconMargin / 2 + w / 2 - image.GetWidth() / 2, y + IconMargin, image.GetWidth(), image.GetHeight(), img_buf);
@@ -432,7 +366,19 @@ class AmiiboIcons: public tsl::elm::Element {
         virtual void layout(u16 parentX, u16 parentY, u16 parentWidth, u16 parentHeight) override {}
 };
 
-class AmiiboGuiHelp : public tsl::Gui {
+// Input shared by every view, checked before the focused element gets it
+class EmuiiboGui : public tsl::Gui {
+    public:
+        virtual bool handleInput(u64 keysDown, u64 keysHeld, const HidTouchState &touchPos, HidAnalogStickState joyStickPosLeft, HidAnalogStickState joyStickPosRight) override {
+            if((keysDown & ActionKeyComboToggleProfiler) && ((keysHeld & ActionKeyComboToggleProfiler) == ActionKeyComboToggleProfiler)) {
+                ui::prof::SetEnabled(!ui::prof::IsEnabled());
+                return true;
+            }
+            return false;
+        }
+};
+
+class AmiiboGuiHelp : public EmuiiboGui {
     public:
         virtual tsl::elm::Element* createUI() override {
             auto root_frame = new ui::elm::DoubleSectionOverlayFrame("Help"_tr, MakeVersionString(), ui::SectionsLayout::big_top, false);
@@ -449,16 +395,77 @@ class AmiiboGuiHelp : public tsl::Gui {
             top_list->addItem(new ui::elm::SmallListItem("ResetActiveVirtualAmiibo"_tr, GetActionKeyGlyph(ActionKeyResetActiveVirtualAmiibo)));
             top_list->addItem(new ui::elm::SmallListItem("EnableRandomUuid"_tr, GetActionKeyGlyph(ActionKeyEnableRandomUuid)));
             top_list->addItem(new ui::elm::SmallListItem("DisableRandomUuid"_tr, GetActionKeyGlyph(ActionKeyDisableRandomUuid)));
+            top_list->addItem(new ui::elm::SmallListItem("ToggleProfiler"_tr, GetActionKeyGlyph(HidNpadButton_StickL) + " + " + GetActionKeyGlyph(HidNpadButton_StickR)));
+
+            return root_frame;
+        }
+};
+
+class AmiiboSearchGui : public EmuiiboGui {
+    private:
+        static constexpr auto SearchCharacters = "abcdefghijklmnopqrstuvwxyz0123456789 -.'&";
+        static constexpr size_t MaxSearchResults = 50;
+
+        tsl::elm::List *results_list;
+        ui::elm::CharacterPickerListItem *picker_item;
+
+        void UpdateResults(const std::string &query) {
+            this->results_list->clear();
+            if(query.empty()) {
+                this->results_list->addItem(new ui::elm::CustomCategoryHeader("SearchIndexedVirtualAmiibos"_tr + ": " + std::to_string(app::GetSearchIndexEntryCount()), true, true));
+                return;
+            }
+
+            // Straight from the in-memory index, no SD or IPC access per keystroke
+            const auto results = app::Search(query, MaxSearchResults);
+            this->results_list->addItem(new ui::elm::CustomCategoryHeader("SearchResults"_tr + ": " + std::to_string(results.size()), true, true));
+            for(const auto result: results) {
+                auto item = new AmiiboListElement(result->path, result->name);
+                item->SetActionListener([&](auto& caller) {
+                    SelectVirtualAmiibo(caller.GetPath());
+                });
+                this->results_list->addItem(item);
+            }
+        }
+
+    public:
+        virtual tsl::elm::Element *createUI() override {
+            // A full scan is only needed the first time, afterwards the persisted index is kept up to date while browsing
+            if(!app::IsSearchIndexBuilt()) {
+                app::RebuildSearchIndex();
+            }
+
+            auto root_frame = new ui::elm::DoubleSectionOverlayFrame("Search"_tr, MakeVersionString(), ui::SectionsLayout::big_top, true);
+            this->results_list = new tsl::elm::List();
+            root_frame->setTopSection(this->results_list);
+            auto bottom_list = new tsl::elm::List();
+            root_frame->setBottomSection(bottom_list);
+
+            bottom_list->addItem(new ui::elm::CustomCategoryHeader("SearchPickerHelp"_tr, false, true));
+            this->picker_item = new ui::elm::CharacterPickerListItem("Search"_tr, SearchCharacters);
+            this->picker_item->setTypedChangedListener([&](const std::string &typed) {
+                this->UpdateResults(typed);
+            });
+            bottom_list->addItem(this->picker_item);
+
+            auto rebuild_item = new ActionListElement("RebuildSearchIndex"_tr, GetIconGlyph(Icon::Reset));
+            rebuild_item->SetActionListener([&](auto&) {
+                app::RebuildSearchIndex();
+                this->UpdateResults(this->picker_item->getTyped());
+            });
+            bottom_list->addItem(rebuild_item);
 
+            this->UpdateResults("");
             return root_frame;
         }
 };
 
-class AmiiboGui : public tsl::Gui {
+class AmiiboGui : public EmuiiboGui {
     public:
         enum class Kind {
             Root,
             Favorites,
+            Recent,
             Folder
         };
 
@@ -474,6 +481,9 @@ class AmiiboGui : public tsl::Gui {
         AmiiboIcons* amiibo_icons;
         tsl::elm::List *top_list;
         CustomList *bottom_list;
+        std::unordered_map<std::string, GuiListElement*> favorite_items;
+
+        static constexpr size_t RevalidatedFavoritesPerFrame = 4;
 
     public:
         AmiiboGui(const Kind kind, const std::string &path) : kind(kind), base_path(path) {}
@@ -495,54 +505,74 @@ class AmiiboGui : public tsl::Gui {
             if(this->kind == Kind::Root) {
                 this->bottom_list->addItem(createRootElement());
                 this->bottom_list->addItem(createFavoritesElement());
+                this->bottom_list->addItem(createRecentElement());
+                this->bottom_list->addItem(createSearchElement());
                 this->bottom_list->addItem(createResetElement());
                 this->bottom_list->addItem(createHelpElement());
             }
-            else {
-                // Iterate base folder
+            else if(this->kind == Kind::Favorites) {
+                // Rendered from the cached display data, which gets revalidated (a few favorites per frame) in update()
                 u32 virtual_amiibo_count = 0;
+                this->favorite_items.clear();
+                for(const auto &[fav_path, fav_data]: app::GetFavoritesDisplayData()) {
+                    GuiListElement *new_item;
+                    if(fav_data.is_virtual_amiibo) {
+                        new_item = this->createAmiiboElement(fav_path, fav_data.name);
+                        virtual_amiibo_count++;
+                    }
+                    else {
+                        new_item = this->createFolderElement(fav_path);
+                    }
 
-                std::vector<std::string> dir_paths;
-                if(this->kind == Kind::Favorites) {
-                    dir_paths = g_Favorites;
+                    this->favorite_items[fav_path] = new_item;
+                    this->bottom_list->addItem(new_item);
+                    if(new_item->ContainsVirtualAmiiboPath()) {
+                        this->bottom_list->setCustomInitialFocus(new_item);
+                    }
                 }
-                else if(this->kind == Kind::Folder) {
-                    tsl::hlp::doWithSDCardHandle([&]() {
-                        auto dir = opendir(this->base_path.c_str());
-                        if(dir) {
-                            while(true) {
-                                auto entry = readdir(dir);
-                                if(entry == nullptr) {
-                                    break;
-                                }
-                                if(entry->d_type & DT_DIR) {
-                                    const auto dir_path = this->base_path + "/" + entry->d_name;
-                                    dir_paths.push_back(dir_path);
-                                }
-                            }
-                            closedir(dir);
-                        }
-                    });
+                app::StartFavoritesRevalidation();
+
+                this->bottom_list->addItem(new ui::elm::CustomCategoryHeader("AvailableVirtualAmiibos"_tr + " '" + app::GetPathFileName(this->base_path) + "': " + std::to_string(virtual_amiibo_count), true, true), 0, 0);
+            }
+            else if(this->kind == Kind::Recent) {
+                // Cached names, no need to probe anything
+                const auto recent = app::GetRecent();
+                for(const auto &entry: recent) {
+                    auto new_item = this->createAmiiboElement(entry.path, entry.name);
+                    this->bottom_list->addItem(new_item);
+                    if(new_item->ContainsVirtualAmiiboPath()) {
+                        this->bottom_list->setCustomInitialFocus(new_item);
+                    }
                 }
 
-                std::sort(dir_paths.begin(), dir_paths.end());
-                for(const auto &dir_path: dir_paths) {
-                    GuiListElement *new_item = this->createAmiiboElement(dir_path);
-                    if(new_item) {
+                this->bottom_list->addItem(new ui::elm::CustomCategoryHeader("RecentVirtualAmiibos"_tr + ": " + std::to_string(recent.size()), true, true), 0, 0);
+            }
+            else {
+                // Iterate base folder
+                u32 virtual_amiibo_count = 0;
+                std::vector<app::SearchIndexEntry> found_virtual_amiibos;
+
+                app::ScanEntries(app::ListDirectories(this->base_path), [&](app::FolderEntry &&entry) {
+                    GuiListElement *new_item;
+                    if(entry.is_virtual_amiibo) {
+                        new_item = this->createAmiiboElement(entry.path, entry.virtual_amiibo.name);
+                        found_virtual_amiibos.push_back({ entry.path, entry.virtual_amiibo.name });
                         virtual_amiibo_count++;
                     }
                     else {
-                        new_item = this->createFolderElement(dir_path);
+                        new_item = this->createFolderElement(entry.path);
                     }
-    
+
                     this->bottom_list->addItem(new_item);
                     if(new_item->ContainsVirtualAmiiboPath()) {
                         this->bottom_list->setCustomInitialFocus(new_item);
                     }
-                }
+                });
+
+                app::UpdateSearchIndexDirectory(this->base_path, std::move(found_virtual_amiibos));
 
                 // Information about current folder
-                this->bottom_list->addItem(new ui::elm::CustomCategoryHeader("AvailableVirtualAmiibos"_tr + " '" + GetPathFileName(this->base_path) + "': " + std::to_string(virtual_amiibo_count), true, true), 0, 0);
+                this->bottom_list->addItem(new ui::elm::CustomCategoryHeader("AvailableVirtualAmiibos"_tr + " '" + app::GetPathFileName(this->base_path) + "': " + std::to_string(virtual_amiibo_count), true, true), 0, 0);
             }
 
             // Emulation status
@@ -620,15 +650,15 @@ class AmiiboGui : public tsl::Gui {
                 }
                 if(keys & action_key_prev_area) {
                     if(g_VirtualAmiiboCurrentAreaIndex > 0) {
-                        const auto new_access_id = g_VirtualAmiiboAreaEntries[g_VirtualAmiiboCurrentAreaIndex - 1].access_id;
+                        const auto new_access_id = g_VirtualAmiiboAreas.GetEntry(g_VirtualAmiiboCurrentAreaIndex - 1).access_id;
                         if(R_SUCCEEDED(emu::SetActiveVirtualAmiiboCurrentArea(new_access_id))) {
                             g_VirtualAmiiboCurrentAreaIndex--;
                         }
                     }
                 }
                 if(keys & action_key_next_area) {
-                    if(g_VirtualAmiiboCurrentAreaIndex < (g_VirtualAmiiboAreaCount - 1)) {
-                        const auto new_access_id = g_VirtualAmiiboAreaEntries[g_VirtualAmiiboCurrentAreaIndex + 1].access_id;
+                    if((g_VirtualAmiiboCurrentAreaIndex + 1) < g_VirtualAmiiboAreas.GetCount()) {
+                        const auto new_access_id = g_VirtualAmiiboAreas.GetEntry(g_VirtualAmiiboCurrentAreaIndex + 1).access_id;
                         if(R_SUCCEEDED(emu::SetActiveVirtualAmiiboCurrentArea(new_access_id))) {
                             g_VirtualAmiiboCurrentAreaIndex++;
                         }
@@ -660,6 +690,7 @@ class AmiiboGui : public tsl::Gui {
             if(!g_InitializationOk) {
                 return;
             }
+            ui::prof::ScopedRegion region("update");
 
             const auto is_intercepted = emu::IsCurrentApplicationIdIntercepted();
             this->game_header->setColoredValue(is_intercepted ? "Intercepted"_tr : "NotIntercepted"_tr, is_intercepted ? tsl::style::color::ColorHighlight : ui::style::color::ColorWarning);
@@ -684,9 +715,20 @@ class AmiiboGui : public tsl::Gui {
 
             this->emulation_toggle_item->setState(emu::GetEmulationStatus() == emu::EmulationStatus::On);
 
+            if(this->kind == Kind::Favorites) {
+                app::RevalidateFavorites(RevalidatedFavoritesPerFrame, [&](const std::string &fav_path, const app::FavoriteDisplayData &fav_data) {
+                    // A favorite which turned into a folder (or the other way around) shows as such once the view is opened again
+                    const auto it = this->favorite_items.find(fav_path);
+                    if((it != this->favorite_items.end()) && fav_data.is_virtual_amiibo) {
+                        it->second->setText(fav_data.name);
+                    }
+                });
+            }
+
             if(has_active_virtual_amiibo) {
-                if(g_VirtualAmiiboAreaCount > 0) {
-                    this->area_header->setText("SelectedArea"_tr + " (" + std::to_string(g_VirtualAmiiboCurrentAreaIndex + 1) + " / " + std::to_string(g_VirtualAmiiboAreaCount) + "): " + g_VirtualAmiiboAreaTitles[g_VirtualAmiiboCurrentAreaIndex]);
+                if(!g_VirtualAmiiboAreas.IsEmpty()) {
+                    const auto is_running_application_area = g_HasRunningApplicationAccessId && (g_VirtualAmiiboAreas.GetEntry(g_VirtualAmiiboCurrentAreaIndex).access_id == g_RunningApplicationAccessId);
+                    this->area_header->setText("SelectedArea"_tr + " (" + std::to_string(g_VirtualAmiiboCurrentAreaIndex + 1) + " / " + std::to_string(g_VirtualAmiiboAreas.GetCount()) + "): " + (is_running_application_area ? GetIconGlyph(Icon::RunningApplication) + " " : "") + std::string(g_VirtualAmiiboAreas.GetTitle(g_VirtualAmiiboCurrentAreaIndex)));
                 }
                 else {
                     this->area_header->setText("NoVirtualAmiiboAreas"_tr);
@@ -710,9 +752,9 @@ class AmiiboGui : public tsl::Gui {
                 // When root gets selected for the first time and we have an active virtual amiibo, we start directly at the active virtual amiibo dir
                 static bool is_first_time = true;
                 if(is_first_time && IsActiveVirtualAmiiboValid()) {
-                    const auto active_virtual_amiibo_rel_dir = GetBaseDirectory(GetRelativePathTo(g_VirtualAmiiboDirectory, g_ActiveVirtualAmiiboPath));
+                    const auto active_virtual_amiibo_rel_dir = app::GetBaseDirectory(app::GetRelativePathTo(g_VirtualAmiiboDirectory, g_ActiveVirtualAmiiboPath));
                     auto incremental_path = g_VirtualAmiiboDirectory;
-                    for(const auto &dir_item: SplitPath(active_virtual_amiibo_rel_dir)) {
+                    for(const auto &dir_item: app::SplitPath(active_virtual_amiibo_rel_dir)) {
                         incremental_path += "/" + dir_item;
                         tsl::changeTo<AmiiboGui>(Kind::Folder, incremental_path);
                     }
@@ -730,6 +772,22 @@ class AmiiboGui : public tsl::Gui {
             return item;
         }
 
+        VirtualListElement* createSearchElement() {
+            auto item = new VirtualListElement("SearchVirtualAmiibos"_tr);
+            item->SetActionListener([&](auto&) {
+                tsl::changeTo<AmiiboSearchGui>();
+            });
+            return item;
+        }
+
+        VirtualListElement* createRecentElement() {
+            auto item = new VirtualListElement("ViewRecentVirtualAmiibos"_tr);
+            item->SetActionListener([&](auto&) {
+                tsl::changeTo<AmiiboGui>(Kind::Recent, "<recent>");
+            });
+            return item;
+        }
+
         ActionListElement* createResetElement() {
             auto item = new ActionListElement("ResetActiveVirtualAmiibo"_tr, GetIconGlyph(Icon::Reset));
             item->SetActionListener([&](auto&) {
@@ -755,22 +813,10 @@ class AmiiboGui : public tsl::Gui {
             return item;
         }
 
-        AmiiboListElement* createAmiiboElement(const std::string &path) {
-            emu::VirtualAmiiboData data = {};
-
-            if(R_FAILED(emu::TryParseVirtualAmiibo(path.c_str(), path.length(), &data))) {
-                return nullptr;
-            }
-
-            auto item = new AmiiboListElement(path, data);
+        AmiiboListElement* createAmiiboElement(const std::string &path, const std::string &name) {
+            auto item = new AmiiboListElement(path, name);
             item->SetActionListener([&](auto& caller) {
-                const auto path = caller.GetPath();
-                if(g_ActiveVirtualAmiiboPath != path) {
-                    SetActiveVirtualAmiibo(path);
-                }
-                else {
-                    ToggleActiveVirtualAmiiboStatus();
-                }
+                SelectVirtualAmiibo(caller.GetPath());
             });
             return item;
         }
@@ -790,19 +836,28 @@ class EmuiiboOverlay : public tsl::Overlay {
                 char virtual_amiibo_dir_str[FS_MAX_PATH] = {};
                 emu::GetVirtualAmiiboDirectory(virtual_amiibo_dir_str, sizeof(virtual_amiibo_dir_str));
                 g_VirtualAmiiboDirectory.assign(virtual_amiibo_dir_str);
+
+                app::StartTitleResolver();
             }
         }
 
         virtual void exitServices() override {
-            SaveFavorites();
+            app::SaveFavorites();
+            app::SaveRecent();
+            app::SaveSearchIndex();
+            app::StopTitleResolver();
+            app::SaveTitleCache();
             nsExit();
             pmdmntExit();
             emu::Exit();
         }
 
         virtual std::unique_ptr<tsl::Gui> loadInitialGui() override {
+            app::LoadTitleCache();
             LoadActiveVirtualAmiibo();
-            LoadFavorites();
+            app::LoadFavorites();
+            app::LoadRecent();
+            app::LoadSearchIndex(g_VirtualAmiiboDirectory);
             return initially<AmiiboGui>(AmiiboGui::Kind::Root, "<root>");
         }
 };
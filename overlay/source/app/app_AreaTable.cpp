@@ -0,0 +1,83 @@
+#include <app/app_AreaTable.hpp>
+#include <app/app_TitleCache.hpp>
+#include <sstream>
+#include <iomanip>
+
+namespace app {
+
+    namespace {
+
+        constexpr size_t AreaPageCount = 16;
+
+        std::string MakeDefaultAreaTitle(const emu::VirtualAmiiboAreaEntry &entry) {
+            std::stringstream strm;
+            strm << std::hex << std::uppercase << std::setfill('0') << "0x" << std::setw(0x8) << entry.access_id << " (" << std::setw(0x10) << entry.program_id << ")";
+            return strm.str();
+        }
+
+    }
+
+    void AreaTable::SetTitle(Area &area, const std::string_view &title) {
+        area.title_offset = this->title_arena.size();
+        area.title_length = std::min<size_t>(title.size(), UINT16_MAX);
+        this->title_arena.append(title.substr(0, area.title_length));
+    }
+
+    Result AreaTable::LoadActiveVirtualAmiiboAreas() {
+        this->Clear();
+
+        u32 area_count = 0;
+        const auto rc = emu::GetActiveVirtualAmiiboAreaCount(&area_count);
+        if(R_FAILED(rc)) {
+            return rc;
+        }
+        this->areas.reserve(area_count);
+
+        emu::VirtualAmiiboAreaEntry page[AreaPageCount];
+        while(this->areas.size() < area_count) {
+            u32 page_count = 0;
+            const auto rc = emu::GetActiveVirtualAmiiboAreasFrom(this->areas.size(), page, sizeof(page), &page_count);
+            if(R_FAILED(rc)) {
+                return rc;
+            }
+            if(page_count == 0) {
+                // Areas might have been removed in the meantime
+                break;
+            }
+
+            for(u32 i = 0; i < page_count; i++) {
+                auto &area = this->areas.emplace_back();
+                area.entry = page[i];
+                area.title_resolved = false;
+                this->SetTitle(area, MakeDefaultAreaTitle(page[i]));
+            }
+        }
+
+        return 0;
+    }
+
+    bool AreaTable::FindByAccessId(const u32 access_id, u32 &out_idx) const {
+        for(u32 i = 0; i < this->areas.size(); i++) {
+            if(this->areas[i].entry.access_id == access_id) {
+                out_idx = i;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::string_view AreaTable::GetTitle(const u32 idx) {
+        auto &area = this->areas.at(idx);
+        if(!area.title_resolved) {
+            std::string title;
+            if(TryGetApplicationTitle(area.entry.program_id, title)) {
+                this->SetTitle(area, title);
+                area.title_resolved = true;
+            }
+        }
+
+        return std::string_view(this->title_arena).substr(area.title_offset, area.title_length);
+    }
+
+}
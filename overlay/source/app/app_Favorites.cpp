@@ -0,0 +1,193 @@
+#include <app/app_Favorites.hpp>
+#include <app/app_Folder.hpp>
+#include <tesla.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <sys/stat.h>
+
+namespace app {
+
+    namespace {
+
+        constexpr auto FavoritesFile = "sdmc:/emuiibo/overlay/favorites.txt";
+        constexpr auto FavoritesCacheFile = "sdmc:/emuiibo/overlay/favorites_cache.txt";
+        constexpr char FavoritesCacheSeparator = '\t';
+
+        std::vector<std::string> g_Favorites;
+
+        std::unordered_map<std::string, FavoriteDisplayData> g_FavoritesCache;
+        bool g_FavoritesCacheDirty = false;
+        std::vector<std::string> g_PendingRevalidationPaths;
+
+        // Needs the SD card to be opened
+        u64 GetFavoriteStamp(const std::string &path) {
+            u64 stamp = 0;
+            struct stat st;
+            if(stat(path.c_str(), &st) == 0) {
+                stamp = st.st_mtime;
+            }
+            if(stat((path + "/amiibo.json").c_str(), &st) == 0) {
+                stamp = std::max<u64>(stamp, st.st_mtime);
+            }
+            return stamp;
+        }
+
+        // Opens the SD card by itself (through ScanEntries), so it must not be called while it's opened
+        void ProbeFavorites(std::vector<std::string> paths, const FavoriteChangedCallback &on_probed) {
+            std::vector<u64> stamps;
+            stamps.reserve(paths.size());
+            std::sort(paths.begin(), paths.end());
+            tsl::hlp::doWithSDCardHandle([&]() {
+                // Stamped before probing, so that changes while probing are noticed by the next revalidation
+                for(const auto &path: paths) {
+                    stamps.push_back(GetFavoriteStamp(path));
+                }
+            });
+
+            size_t entry_idx = 0;
+            ScanEntries(std::move(paths), [&](FolderEntry &&entry) {
+                auto &data = g_FavoritesCache[entry.path];
+                data = { entry.is_virtual_amiibo, entry.is_virtual_amiibo ? entry.virtual_amiibo.name : "", stamps.at(entry_idx++) };
+                g_FavoritesCacheDirty = true;
+                on_probed(entry.path, data);
+            });
+        }
+
+        void LoadFavoritesCache() {
+            g_FavoritesCache.clear();
+            g_FavoritesCacheDirty = false;
+            g_PendingRevalidationPaths.clear();
+            tsl::hlp::doWithSDCardHandle([&]() {
+                // Each line: <path>\t<stamp>\t<is-virtual-amiibo>\t<name>
+                std::ifstream cache_file(FavoritesCacheFile);
+                std::string line;
+                while(std::getline(cache_file, line)) {
+                    std::stringstream strm(line);
+                    std::string path;
+                    std::string stamp_str;
+                    std::string is_virtual_amiibo_str;
+                    FavoriteDisplayData data;
+                    if(std::getline(strm, path, FavoritesCacheSeparator) && std::getline(strm, stamp_str, FavoritesCacheSeparator) && std::getline(strm, is_virtual_amiibo_str, FavoritesCacheSeparator)) {
+                        // Empty for regular folders
+                        std::getline(strm, data.name);
+                        data.stamp = strtoull(stamp_str.c_str(), nullptr, 10);
+                        data.is_virtual_amiibo = is_virtual_amiibo_str == "1";
+                        g_FavoritesCache[path] = std::move(data);
+                    }
+                }
+            });
+        }
+
+        void SaveFavoritesCache() {
+            if(!g_FavoritesCacheDirty) {
+                return;
+            }
+
+            tsl::hlp::doWithSDCardHandle([&]() {
+                std::ofstream cache_file(FavoritesCacheFile, std::ofstream::out | std::ofstream::trunc);
+                for(const auto &[path, data]: g_FavoritesCache) {
+                    // Entries of removed favorites are dropped here
+                    if(IsFavorite(path)) {
+                        cache_file << path << FavoritesCacheSeparator << data.stamp << FavoritesCacheSeparator << (data.is_virtual_amiibo ? "1" : "0") << FavoritesCacheSeparator << data.name << '\n';
+                    }
+                }
+            });
+            g_FavoritesCacheDirty = false;
+        }
+
+    }
+
+    void LoadFavorites() {
+        g_Favorites.clear();
+        tsl::hlp::doWithSDCardHandle([&]() {
+            std::ifstream favs_file(FavoritesFile);
+            std::string fav_path_str;
+            while(std::getline(favs_file, fav_path_str)) {
+                AddFavorite(fav_path_str);
+            }
+        });
+        LoadFavoritesCache();
+    }
+
+    void SaveFavorites() {
+        tsl::hlp::doWithSDCardHandle([&]() {
+            std::ofstream file(FavoritesFile, std::ofstream::out | std::ofstream::trunc);
+            for(const auto &fav_path: g_Favorites) {
+                file << fav_path << std::endl;
+            }
+        });
+        SaveFavoritesCache();
+    }
+
+    void AddFavorite(const std::string &path) {
+        g_Favorites.push_back(path);
+    }
+
+    void RemoveFavorite(const std::string &path) {
+        g_Favorites.erase(std::remove(g_Favorites.begin(), g_Favorites.end(), path), g_Favorites.end()); 
+        if(g_FavoritesCache.erase(path) > 0) {
+            g_FavoritesCacheDirty = true;
+        }
+    }
+
+    bool IsFavorite(const std::string &path) {
+        return std::find(g_Favorites.begin(), g_Favorites.end(), path) != g_Favorites.end();
+    }
+
+    const std::vector<std::string> &GetFavorites() {
+        return g_Favorites;
+    }
+
+    std::vector<std::pair<std::string, FavoriteDisplayData>> GetFavoritesDisplayData() {
+        std::vector<std::string> uncached_paths;
+        for(const auto &fav_path: g_Favorites) {
+            if(g_FavoritesCache.count(fav_path) == 0) {
+                uncached_paths.push_back(fav_path);
+            }
+        }
+        if(!uncached_paths.empty()) {
+            ProbeFavorites(std::move(uncached_paths), [](const std::string&, const FavoriteDisplayData&) {});
+        }
+
+        std::vector<std::pair<std::string, FavoriteDisplayData>> favs_data;
+        favs_data.reserve(g_Favorites.size());
+        for(const auto &fav_path: g_Favorites) {
+            favs_data.emplace_back(fav_path, g_FavoritesCache.at(fav_path));
+        }
+        std::sort(favs_data.begin(), favs_data.end(), [](const auto &fav_a, const auto &fav_b) {
+            return fav_a.first < fav_b.first;
+        });
+        return favs_data;
+    }
+
+    void StartFavoritesRevalidation() {
+        g_PendingRevalidationPaths = g_Favorites;
+    }
+
+    void RevalidateFavorites(const size_t max_count, FavoriteChangedCallback on_changed) {
+        if(g_PendingRevalidationPaths.empty()) {
+            return;
+        }
+
+        std::vector<std::string> changed_paths;
+        tsl::hlp::doWithSDCardHandle([&]() {
+            for(size_t i = 0; (i < max_count) && !g_PendingRevalidationPaths.empty(); i++) {
+                const auto path = std::move(g_PendingRevalidationPaths.back());
+                g_PendingRevalidationPaths.pop_back();
+
+                // Favorites added since the revalidation started are probed when the view gets opened again
+                const auto it = g_FavoritesCache.find(path);
+                if((it != g_FavoritesCache.end()) && (it->second.stamp != GetFavoriteStamp(path))) {
+                    changed_paths.push_back(path);
+                }
+            }
+        });
+
+        if(!changed_paths.empty()) {
+            ProbeFavorites(std::move(changed_paths), on_changed);
+        }
+    }
+
+}
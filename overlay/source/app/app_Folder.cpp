@@ -0,0 +1,147 @@
+#include <app/app_Folder.hpp>
+#include <tesla.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace app {
+
+    namespace {
+
+        // Classifying threads, the calling one included: emuiibo serves IPC on a single thread, so more than this wouldn't overlap anything else
+        constexpr size_t ScanThreadCount = 3;
+        // Below this, spawning the workers costs more than classifying the entries serially
+        constexpr size_t MinParallelScanEntryCount = 8;
+
+        inline bool ExistsFile(const std::string &path) {
+            struct stat st;
+            return (stat(path.c_str(), &st) == 0) && S_ISREG(st.st_mode);
+        }
+
+        void ClassifyEntry(std::string &&path, FolderEntry &out_entry) {
+            out_entry.virtual_amiibo = {};
+            // Plain folders (no flag) are told apart with a local stat, only virtual amiibos need emuiibo to parse them
+            out_entry.is_virtual_amiibo = ExistsFile(path + "/amiibo.flag") && R_SUCCEEDED(emu::ProbeVirtualAmiibo(path.c_str(), path.length(), &out_entry.virtual_amiibo));
+            out_entry.path = std::move(path);
+        }
+
+    }
+
+    std::vector<std::string> ListDirectories(const std::string &path) {
+        std::vector<std::string> dir_paths;
+        tsl::hlp::doWithSDCardHandle([&]() {
+            auto dir = opendir(path.c_str());
+            if(dir) {
+                while(true) {
+                    auto entry = readdir(dir);
+                    if(entry == nullptr) {
+                        break;
+                    }
+                    if(entry->d_type & DT_DIR) {
+                        const std::string name = entry->d_name;
+                        if((name == ".") || (name == "..")) {
+                            continue;
+                        }
+                        dir_paths.push_back(path + "/" + name);
+                    }
+                }
+                closedir(dir);
+            }
+        });
+        return dir_paths;
+    }
+
+    void ScanEntries(std::vector<std::string> paths, FolderEntryCallback on_entry) {
+        std::sort(paths.begin(), paths.end());
+
+        // The SD card is only kept open once for the whole scan, workers don't touch the handle themselves
+        tsl::hlp::doWithSDCardHandle([&]() {
+            const auto entry_count = paths.size();
+            if(entry_count < MinParallelScanEntryCount) {
+                for(auto &path: paths) {
+                    FolderEntry entry;
+                    ClassifyEntry(std::move(path), entry);
+                    on_entry(std::move(entry));
+                }
+                return;
+            }
+
+            // Every entry has its own slot, so workers never wait on each other, only the publishing is ordered
+            std::vector<FolderEntry> entries(entry_count);
+            auto entries_done = std::make_unique<bool[]>(entry_count);
+            std::mutex done_lock;
+            std::condition_variable done_cond;
+            size_t next_entry_idx = 0;
+
+            const auto worker_fn = [&]() {
+                while(true) {
+                    size_t entry_idx;
+                    {
+                        std::scoped_lock lk(done_lock);
+                        if(next_entry_idx >= entry_count) {
+                            break;
+                        }
+                        entry_idx = next_entry_idx++;
+                    }
+
+                    ClassifyEntry(std::move(paths[entry_idx]), entries[entry_idx]);
+                    {
+                        std::scoped_lock lk(done_lock);
+                        entries_done[entry_idx] = true;
+                    }
+                    done_cond.notify_one();
+                }
+            };
+
+            std::vector<std::thread> workers;
+            workers.reserve(ScanThreadCount - 1);
+            for(size_t i = 0; i < (ScanThreadCount - 1); i++) {
+                try {
+                    workers.emplace_back(worker_fn);
+                }
+                catch(const std::system_error&) {
+                    // Out of threads/memory: carry on with the workers which did start, if any (this thread classifies entries too)
+                    break;
+                }
+            }
+
+            for(size_t i = 0; i < entry_count; i++) {
+                std::unique_lock lk(done_lock);
+                while(!entries_done[i]) {
+                    if(next_entry_idx < entry_count) {
+                        // Classify the next pending entry instead of just waiting for the workers
+                        const auto entry_idx = next_entry_idx++;
+                        lk.unlock();
+                        ClassifyEntry(std::move(paths[entry_idx]), entries[entry_idx]);
+                        lk.lock();
+                        entries_done[entry_idx] = true;
+                    }
+                    else {
+                        done_cond.wait(lk);
+                    }
+                }
+                lk.unlock();
+                on_entry(std::move(entries[i]));
+            }
+
+            for(auto &worker: workers) {
+                worker.join();
+            }
+        });
+    }
+
+    std::vector<FolderEntry> ClassifyEntries(std::vector<std::string> paths) {
+        std::vector<FolderEntry> entries;
+        entries.reserve(paths.size());
+        ScanEntries(std::move(paths), [&](FolderEntry &&entry) {
+            entries.push_back(std::move(entry));
+        });
+        return entries;
+    }
+
+}
@@ -0,0 +1,38 @@
+#include <app/app_Paths.hpp>
+#include <sstream>
+
+namespace app {
+
+    std::vector<std::string> SplitPath(const std::string &path) {
+        std::vector<std::string> items;
+        std::stringstream ss(path);
+        std::string item;
+        while(std::getline(ss, item, '/')) {
+            items.push_back(item);
+        }
+        return items;
+    }
+
+    std::string GetRelativePathTo(const std::string &ref_path, const std::string &in_path) {
+        const auto ref_path_items = SplitPath(ref_path);
+        const auto in_path_items = SplitPath(in_path);
+        size_t i = 0;
+        std::string rel_path;
+        for(; i < ref_path_items.size(); i++) {
+            const auto cur_ref_path_item = ref_path_items.at(i);
+            const auto cur_in_path_item = in_path_items.at(i);
+            if(cur_ref_path_item != cur_in_path_item) {
+                rel_path += "../";
+            }
+        }
+        
+        for(size_t j = i; j < in_path_items.size(); j++) {
+            rel_path += in_path_items.at(j) + '/';
+        }
+        if(!rel_path.empty()) {
+            rel_path.pop_back();
+        }
+        return rel_path;
+    }
+
+}
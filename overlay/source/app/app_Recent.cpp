@@ -0,0 +1,93 @@
+#include <app/app_Recent.hpp>
+#include <tesla.hpp>
+#include <fstream>
+#include <list>
+#include <unordered_map>
+
+namespace app {
+
+    namespace {
+
+        constexpr auto RecentFile = "sdmc:/emuiibo/overlay/recent.txt";
+        constexpr char RecentSeparator = '\t';
+        constexpr size_t MaxRecentCount = 15;
+
+        // Most recent first, the map points into the list so that moving an entry to the front never searches it
+        std::list<RecentEntry> g_Recent;
+        std::unordered_map<std::string, std::list<RecentEntry>::iterator> g_RecentByPath;
+        bool g_RecentDirty = false;
+
+    }
+
+    void LoadRecent() {
+        g_Recent.clear();
+        g_RecentByPath.clear();
+        tsl::hlp::doWithSDCardHandle([&]() {
+            // Each line: <path>\t<name>, most recent first
+            std::ifstream recent_file(RecentFile);
+            std::string line;
+            while(std::getline(recent_file, line) && (g_Recent.size() < MaxRecentCount)) {
+                const auto sep_pos = line.find(RecentSeparator);
+                if(sep_pos == std::string::npos) {
+                    continue;
+                }
+
+                auto path = line.substr(0, sep_pos);
+                if(g_RecentByPath.count(path) == 0) {
+                    const auto it = g_Recent.insert(g_Recent.end(), { path, line.substr(sep_pos + 1) });
+                    g_RecentByPath.emplace(std::move(path), it);
+                }
+            }
+        });
+        g_RecentDirty = false;
+    }
+
+    void SaveRecent() {
+        if(!g_RecentDirty) {
+            return;
+        }
+
+        tsl::hlp::doWithSDCardHandle([&]() {
+            std::ofstream recent_file(RecentFile, std::ofstream::out | std::ofstream::trunc);
+            for(const auto &entry: g_Recent) {
+                recent_file << entry.path << RecentSeparator << entry.name << '\n';
+            }
+        });
+        g_RecentDirty = false;
+    }
+
+    void PushRecent(const std::string &path, const std::string &name) {
+        const auto it = g_RecentByPath.find(path);
+        if(it != g_RecentByPath.end()) {
+            if((it->second == g_Recent.begin()) && (it->second->name == name)) {
+                return;
+            }
+
+            it->second->name = name;
+            g_Recent.splice(g_Recent.begin(), g_Recent, it->second);
+        }
+        else {
+            g_Recent.push_front({ path, name });
+            g_RecentByPath.emplace(path, g_Recent.begin());
+            if(g_Recent.size() > MaxRecentCount) {
+                g_RecentByPath.erase(g_Recent.back().path);
+                g_Recent.pop_back();
+            }
+        }
+        g_RecentDirty = true;
+    }
+
+    void RemoveRecent(const std::string &path) {
+        const auto it = g_RecentByPath.find(path);
+        if(it != g_RecentByPath.end()) {
+            g_Recent.erase(it->second);
+            g_RecentByPath.erase(it);
+            g_RecentDirty = true;
+        }
+    }
+
+    std::vector<RecentEntry> GetRecent() {
+        return { g_Recent.begin(), g_Recent.end() };
+    }
+
+}
@@ -0,0 +1,230 @@
+#include <app/app_SearchIndex.hpp>
+#include <app/app_Folder.hpp>
+#include <app/app_Paths.hpp>
+#include <tesla.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace app {
+
+    namespace {
+
+        constexpr auto SearchIndexFile = "sdmc:/emuiibo/overlay/search_index.txt";
+        constexpr char SearchIndexSeparator = '\t';
+
+        // Shorter queries are matched by scanning every key, which is cheap enough for them
+        constexpr size_t NgramSize = 3;
+
+        std::string g_RootPath;
+        // Sorted by path
+        std::vector<SearchIndexEntry> g_Entries;
+        bool g_Built = false;
+        bool g_Dirty = false;
+
+        // Derived from the entries, only rebuilt on the first search after they changed
+        std::vector<std::string> g_Keys;
+        std::unordered_map<u32, std::vector<u32>> g_NgramEntries;
+        bool g_KeysOutdated = true;
+
+        inline char ToLower(const char c) {
+            // Only ASCII is folded, UTF-8 sequences are left untouched
+            return ((c >= 'A') && (c <= 'Z')) ? (c - 'A' + 'a') : c;
+        }
+
+        inline std::string MakeLower(const std::string &str) {
+            std::string lower_str(str);
+            std::transform(lower_str.begin(), lower_str.end(), lower_str.begin(), ToLower);
+            return lower_str;
+        }
+
+        inline u32 MakeNgram(const char *str) {
+            return (static_cast<u8>(str[0]) << 16) | (static_cast<u8>(str[1]) << 8) | static_cast<u8>(str[2]);
+        }
+
+        std::string MakeKey(const SearchIndexEntry &entry) {
+            auto rel_path = entry.path;
+            if(rel_path.starts_with(g_RootPath + "/")) {
+                rel_path.erase(0, g_RootPath.length() + 1);
+            }
+            return MakeLower(entry.name) + "\n" + MakeLower(rel_path);
+        }
+
+        void SortEntries() {
+            std::sort(g_Entries.begin(), g_Entries.end(), [](const SearchIndexEntry &entry_a, const SearchIndexEntry &entry_b) {
+                return entry_a.path < entry_b.path;
+            });
+        }
+
+        void EnsureKeys() {
+            if(!g_KeysOutdated) {
+                return;
+            }
+
+            g_Keys.clear();
+            g_Keys.reserve(g_Entries.size());
+            g_NgramEntries.clear();
+            for(u32 i = 0; i < g_Entries.size(); i++) {
+                const auto &key = g_Keys.emplace_back(MakeKey(g_Entries[i]));
+                for(size_t j = 0; (j + NgramSize) <= key.length(); j++) {
+                    auto &ngram_entries = g_NgramEntries[MakeNgram(key.c_str() + j)];
+                    // Entries are visited in order, so every list stays sorted and free of duplicates
+                    if(ngram_entries.empty() || (ngram_entries.back() != i)) {
+                        ngram_entries.push_back(i);
+                    }
+                }
+            }
+            g_KeysOutdated = false;
+        }
+
+        void SetEntries(std::vector<SearchIndexEntry> entries) {
+            g_Entries = std::move(entries);
+            SortEntries();
+            g_KeysOutdated = true;
+        }
+
+    }
+
+    void LoadSearchIndex(const std::string &root_path) {
+        g_RootPath = root_path;
+        g_Built = false;
+        g_Dirty = false;
+
+        std::vector<SearchIndexEntry> entries;
+        tsl::hlp::doWithSDCardHandle([&]() {
+            // First line: the root path; then each line: <path>\t<name>
+            std::ifstream index_file(SearchIndexFile);
+            std::string line;
+            if(!std::getline(index_file, line) || (line != root_path)) {
+                return;
+            }
+
+            while(std::getline(index_file, line)) {
+                const auto sep_pos = line.find(SearchIndexSeparator);
+                if(sep_pos != std::string::npos) {
+                    entries.push_back({ line.substr(0, sep_pos), line.substr(sep_pos + 1) });
+                }
+            }
+            g_Built = true;
+        });
+        SetEntries(std::move(entries));
+    }
+
+    void SaveSearchIndex() {
+        if(!g_Dirty) {
+            return;
+        }
+
+        tsl::hlp::doWithSDCardHandle([&]() {
+            std::ofstream index_file(SearchIndexFile, std::ofstream::out | std::ofstream::trunc);
+            index_file << g_RootPath << '\n';
+            for(const auto &entry: g_Entries) {
+                index_file << entry.path << SearchIndexSeparator << entry.name << '\n';
+            }
+        });
+        g_Dirty = false;
+    }
+
+    bool IsSearchIndexBuilt() {
+        return g_Built;
+    }
+
+    void RebuildSearchIndex() {
+        std::vector<SearchIndexEntry> entries;
+        std::vector<std::string> pending_dirs = { g_RootPath };
+        while(!pending_dirs.empty()) {
+            const auto dir_path = std::move(pending_dirs.back());
+            pending_dirs.pop_back();
+
+            ScanEntries(ListDirectories(dir_path), [&](FolderEntry &&entry) {
+                if(entry.is_virtual_amiibo) {
+                    entries.push_back({ std::move(entry.path), entry.virtual_amiibo.name });
+                }
+                else {
+                    pending_dirs.push_back(std::move(entry.path));
+                }
+            });
+        }
+
+        SetEntries(std::move(entries));
+        g_Built = true;
+        g_Dirty = true;
+    }
+
+    void UpdateSearchIndexDirectory(const std::string &dir_path, std::vector<SearchIndexEntry> entries) {
+        // A partial index would look complete, only keep an already built one updated
+        if(!g_Built) {
+            return;
+        }
+
+        const auto is_in_dir = [&](const SearchIndexEntry &entry) {
+            return GetBaseDirectory(entry.path) == dir_path;
+        };
+
+        std::vector<SearchIndexEntry> old_entries;
+        for(const auto &entry: g_Entries) {
+            if(is_in_dir(entry)) {
+                old_entries.push_back(entry);
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const SearchIndexEntry &entry_a, const SearchIndexEntry &entry_b) {
+            return entry_a.path < entry_b.path;
+        });
+        const auto same_entries = std::equal(old_entries.begin(), old_entries.end(), entries.begin(), entries.end(), [](const SearchIndexEntry &entry_a, const SearchIndexEntry &entry_b) {
+            return (entry_a.path == entry_b.path) && (entry_a.name == entry_b.name);
+        });
+        if(same_entries) {
+            return;
+        }
+
+        g_Entries.erase(std::remove_if(g_Entries.begin(), g_Entries.end(), is_in_dir), g_Entries.end());
+        std::move(entries.begin(), entries.end(), std::back_inserter(g_Entries));
+        SortEntries();
+        g_KeysOutdated = true;
+        g_Dirty = true;
+    }
+
+    size_t GetSearchIndexEntryCount() {
+        return g_Entries.size();
+    }
+
+    std::vector<const SearchIndexEntry*> Search(const std::string &query, const size_t max_results) {
+        EnsureKeys();
+        const auto lower_query = MakeLower(query);
+
+        // Candidates: the entries containing the query's rarest n-gram, or every entry for short queries
+        const std::vector<u32> *candidates = nullptr;
+        if(lower_query.length() >= NgramSize) {
+            static const std::vector<u32> NoCandidates;
+            for(size_t i = 0; (i + NgramSize) <= lower_query.length(); i++) {
+                const auto it = g_NgramEntries.find(MakeNgram(lower_query.c_str() + i));
+                const auto ngram_entries = (it != g_NgramEntries.end()) ? &it->second : &NoCandidates;
+                if((candidates == nullptr) || (ngram_entries->size() < candidates->size())) {
+                    candidates = ngram_entries;
+                }
+            }
+        }
+        const auto candidate_count = (candidates != nullptr) ? candidates->size() : g_Keys.size();
+
+        std::vector<const SearchIndexEntry*> name_prefix_results;
+        std::vector<const SearchIndexEntry*> other_results;
+        for(size_t i = 0; (i < candidate_count) && (name_prefix_results.size() < max_results); i++) {
+            const auto entry_idx = (candidates != nullptr) ? (*candidates)[i] : i;
+            const auto &key = g_Keys[entry_idx];
+            const auto match_pos = key.find(lower_query);
+            if(match_pos == 0) {
+                name_prefix_results.push_back(&g_Entries[entry_idx]);
+            }
+            else if((match_pos != std::string::npos) && (other_results.size() < max_results)) {
+                other_results.push_back(&g_Entries[entry_idx]);
+            }
+        }
+
+        for(size_t i = 0; (i < other_results.size()) && (name_prefix_results.size() < max_results); i++) {
+            name_prefix_results.push_back(other_results[i]);
+        }
+        return name_prefix_results;
+    }
+
+}
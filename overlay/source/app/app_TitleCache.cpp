@@ -0,0 +1,200 @@
+#include <app/app_TitleCache.hpp>
+#include <tesla.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace app {
+
+    namespace {
+
+        constexpr auto TitleCacheFile = "sdmc:/emuiibo/overlay/title_cache.txt";
+        constexpr char TitleCacheSeparator = '\t';
+
+        struct TitleCacheEntry {
+            // Installed application version the title was read from (see GetInstalledApplicationVersion)
+            u32 version;
+            std::string title;
+        };
+
+        std::mutex g_TitleCacheLock;
+        std::unordered_map<u64, TitleCacheEntry> g_TitleCache;
+        bool g_TitleCacheDirty = false;
+
+        std::thread g_TitleResolverThread;
+        std::condition_variable g_TitleResolverCondition;
+        std::deque<u64> g_PendingProgramIds;
+        // Titles queued (or already checked) this session: cached titles are also checked once against the installed version
+        std::unordered_set<u64> g_RequestedProgramIds;
+        bool g_TitleResolverShouldExit = false;
+
+        NsApplicationControlData g_TempControlData;
+
+        bool GetInstalledApplicationVersion(const u64 program_id, u32 &out_version) {
+            // Just the content meta records (base application, update...), way cheaper than reading the control data
+            NsApplicationContentMetaStatus meta_statuses[0x10] = {};
+            s32 meta_status_count = 0;
+            if(R_FAILED(nsListApplicationContentMetaStatus(program_id, 0, meta_statuses, std::size(meta_statuses), &meta_status_count))) {
+                return false;
+            }
+
+            // The title comes from the latest installed version (an update's control data replaces the base application's one)
+            auto found = false;
+            out_version = 0;
+            for(s32 i = 0; i < meta_status_count; i++) {
+                const auto &meta_status = meta_statuses[i];
+                if((meta_status.meta_type == NcmContentMetaType_Application) || (meta_status.meta_type == NcmContentMetaType_Patch)) {
+                    out_version = std::max(out_version, meta_status.version);
+                    found = true;
+                }
+            }
+            return found;
+        }
+
+        bool ReadApplicationTitle(const u64 program_id, TitleCacheEntry &out_entry) {
+            if(R_FAILED(nsGetApplicationControlData(NsApplicationControlSource_Storage, program_id, &g_TempControlData, sizeof(g_TempControlData), nullptr))) {
+                return false;
+            }
+
+            auto ok = false;
+            tsl::hlp::doWithSmSession([&]() {
+                NacpLanguageEntry *entry = nullptr;
+                nacpGetLanguageEntry(&g_TempControlData.nacp, &entry);
+                if(entry != nullptr) {
+                    out_entry.title.assign(entry->name, strnlen(entry->name, sizeof(entry->name)));
+                    ok = true;
+                }
+            });
+            return ok;
+        }
+
+        void TitleResolverMain() {
+            while(true) {
+                u64 program_id;
+                {
+                    std::unique_lock lk(g_TitleCacheLock);
+                    g_TitleResolverCondition.wait(lk, []() {
+                        return g_TitleResolverShouldExit || !g_PendingProgramIds.empty();
+                    });
+                    if(g_TitleResolverShouldExit) {
+                        return;
+                    }
+
+                    program_id = g_PendingProgramIds.front();
+                    g_PendingProgramIds.pop_front();
+                }
+
+                // Not installed (anymore): keep whatever title is cached
+                u32 installed_version;
+                if(!GetInstalledApplicationVersion(program_id, installed_version)) {
+                    continue;
+                }
+
+                {
+                    std::scoped_lock lk(g_TitleCacheLock);
+                    const auto it = g_TitleCache.find(program_id);
+                    if((it != g_TitleCache.end()) && (it->second.version == installed_version)) {
+                        continue;
+                    }
+                }
+
+                // The control data read is the slow part, keep it outside the lock
+                TitleCacheEntry entry = { installed_version, {} };
+                if(ReadApplicationTitle(program_id, entry)) {
+                    std::scoped_lock lk(g_TitleCacheLock);
+                    g_TitleCache[program_id] = std::move(entry);
+                    g_TitleCacheDirty = true;
+                }
+                // On failure the program ID stays in the requested set, so it is not queued again
+            }
+        }
+
+    }
+
+    void LoadTitleCache() {
+        std::scoped_lock lk(g_TitleCacheLock);
+        g_TitleCache.clear();
+        g_TitleCacheDirty = false;
+        tsl::hlp::doWithSDCardHandle([&]() {
+            // Each line: <program-id-hex>\t<version-hex>\t<title>
+            std::ifstream cache_file(TitleCacheFile);
+            std::string line;
+            while(std::getline(cache_file, line)) {
+                std::stringstream strm(line);
+                std::string program_id_str;
+                std::string version_str;
+                TitleCacheEntry entry;
+                if(std::getline(strm, program_id_str, TitleCacheSeparator) && std::getline(strm, version_str, TitleCacheSeparator) && std::getline(strm, entry.title)) {
+                    const auto program_id = strtoull(program_id_str.c_str(), nullptr, 16);
+                    if(program_id != 0) {
+                        entry.version = strtoul(version_str.c_str(), nullptr, 16);
+                        g_TitleCache[program_id] = entry;
+                    }
+                }
+            }
+        });
+    }
+
+    void SaveTitleCache() {
+        std::scoped_lock lk(g_TitleCacheLock);
+        if(!g_TitleCacheDirty) {
+            return;
+        }
+
+        tsl::hlp::doWithSDCardHandle([&]() {
+            std::ofstream cache_file(TitleCacheFile, std::ofstream::out | std::ofstream::trunc);
+            for(const auto &[program_id, entry]: g_TitleCache) {
+                cache_file << std::hex << std::uppercase << program_id << TitleCacheSeparator << entry.version << std::dec << TitleCacheSeparator << entry.title << '\n';
+            }
+        });
+        g_TitleCacheDirty = false;
+    }
+
+    void StartTitleResolver() {
+        if(g_TitleResolverThread.joinable()) {
+            return;
+        }
+
+        g_TitleResolverShouldExit = false;
+        g_TitleResolverThread = std::thread(TitleResolverMain);
+    }
+
+    void StopTitleResolver() {
+        if(!g_TitleResolverThread.joinable()) {
+            return;
+        }
+
+        {
+            std::scoped_lock lk(g_TitleCacheLock);
+            g_TitleResolverShouldExit = true;
+            g_PendingProgramIds.clear();
+            g_RequestedProgramIds.clear();
+        }
+        g_TitleResolverCondition.notify_one();
+        g_TitleResolverThread.join();
+    }
+
+    bool TryGetApplicationTitle(const u64 program_id, std::string &out_title) {
+        std::scoped_lock lk(g_TitleCacheLock);
+        // Only reach NS the first time a title is seen this session (to read it, or to check that the cached one still matches the installed version), and never from the caller's thread
+        if(g_TitleResolverThread.joinable() && g_RequestedProgramIds.insert(program_id).second) {
+            g_PendingProgramIds.push_back(program_id);
+            g_TitleResolverCondition.notify_one();
+        }
+
+        // A cached title is shown right away, even if it turns out to be outdated (it gets updated in the background)
+        const auto it = g_TitleCache.find(program_id);
+        if(it != g_TitleCache.end()) {
+            out_title = it->second.title;
+            return true;
+        }
+        return false;
+    }
+
+}
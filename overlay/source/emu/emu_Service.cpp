@@ -127,4 +127,34 @@ namespace emu {
         return serviceDispatchIn(&g_EmuiiboService, 14, uuid_info);
     }
 
+    Result GetActiveVirtualAmiiboAreaCount(u32 *out_area_count) {
+        return serviceDispatchOut(&g_EmuiiboService, 15, *out_area_count);
+    }
+
+    Result GetActiveVirtualAmiiboAreasFrom(const u32 offset, VirtualAmiiboAreaEntry *out_area_buf, const size_t out_area_size, u32 *out_area_count) {
+        return serviceDispatchInOut(&g_EmuiiboService, 16, offset, *out_area_count,
+            .buffer_attrs = {
+                SfBufferAttr_HipcMapAlias | SfBufferAttr_Out
+            },
+            .buffers = {
+                { out_area_buf, out_area_size }
+            },
+        );
+    }
+
+    Result ProbeVirtualAmiibo(const char *path, const size_t path_size, VirtualAmiiboProbeData *out_probe_data) {
+        return serviceDispatchOut(&g_EmuiiboService, 17, *out_probe_data,
+            .buffer_attrs = {
+                SfBufferAttr_HipcMapAlias | SfBufferAttr_In
+            },
+            .buffers = {
+                { path, path_size }
+            },
+        );
+    }
+
+    Result GetCachedAccessId(const u64 program_id, u32 *out_access_id) {
+        return serviceDispatchInOut(&g_EmuiiboService, 18, program_id, *out_access_id);
+    }
+
 }
\ No newline at end of file
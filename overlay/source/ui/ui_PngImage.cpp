@@ -1,6 +1,6 @@
 #include <ui/ui_PngImage.hpp>
 #include <tr/tr_Translation.hpp>
-#include <ui/ui_TeslaExtras.hpp>
+#include <tesla.hpp>
 #include <ui/upng.h>
 
 namespace ui {
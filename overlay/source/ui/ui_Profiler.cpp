@@ -0,0 +1,127 @@
+#include <ui/ui_Profiler.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace ui::prof {
+
+    namespace {
+
+        struct RegionStats {
+            const char *name;
+            u64 cur_frame_ns;
+            u64 history_ns[HistoryFrameCount];
+            u32 bucket_counts[BucketCount];
+        };
+
+        bool g_Enabled = false;
+        // Few regions, so a linear lookup is cheaper than any map
+        std::vector<RegionStats> g_Regions;
+        size_t g_HistoryIndex = 0;
+        size_t g_RecordedFrameCount = 0;
+        bool g_HasFrameStart = false;
+        Clock::time_point g_FrameStart;
+
+        size_t GetBucketIndex(const u64 ns) {
+            size_t idx = 0;
+            for(u64 limit = FirstBucketLimitNs; (ns >= limit) && (idx < BucketCount - 1); limit *= 2) {
+                idx++;
+            }
+            return idx;
+        }
+
+        RegionStats &FindRegion(const char *name) {
+            for(auto &region: g_Regions) {
+                if((region.name == name) || (strcmp(region.name, name) == 0)) {
+                    return region;
+                }
+            }
+
+            // Regions first seen later on get an empty history up to now
+            return g_Regions.emplace_back(RegionStats{ name, 0, {}, {} });
+        }
+
+        inline double ToMs(const u64 ns) {
+            return static_cast<double>(ns) / 1'000'000.0;
+        }
+
+    }
+
+    bool IsEnabled() {
+        return g_Enabled;
+    }
+
+    void SetEnabled(const bool enabled) {
+        g_Enabled = enabled;
+        g_Regions.clear();
+        g_HistoryIndex = 0;
+        g_RecordedFrameCount = 0;
+        g_HasFrameStart = false;
+    }
+
+    void BeginFrame() {
+        if(!g_Enabled) {
+            return;
+        }
+
+        const auto now = Clock::now();
+        if(g_HasFrameStart) {
+            AddRegionTime(FrameRegionName, std::chrono::duration_cast<std::chrono::nanoseconds>(now - g_FrameStart).count());
+
+            const auto history_full = g_RecordedFrameCount == HistoryFrameCount;
+            for(auto &region: g_Regions) {
+                // The oldest frame leaves the histogram as the new one enters it
+                auto &old_ns = region.history_ns[g_HistoryIndex];
+                if(history_full && (old_ns > 0)) {
+                    region.bucket_counts[GetBucketIndex(old_ns)]--;
+                }
+                old_ns = region.cur_frame_ns;
+                if(old_ns > 0) {
+                    region.bucket_counts[GetBucketIndex(old_ns)]++;
+                }
+                region.cur_frame_ns = 0;
+            }
+
+            g_HistoryIndex = (g_HistoryIndex + 1) % HistoryFrameCount;
+            g_RecordedFrameCount = std::min(g_RecordedFrameCount + 1, HistoryFrameCount);
+        }
+
+        g_FrameStart = now;
+        g_HasFrameStart = true;
+    }
+
+    void AddRegionTime(const char *name, const u64 ns) {
+        FindRegion(name).cur_frame_ns += ns;
+    }
+
+    std::vector<RegionSummary> GetRegionSummaries() {
+        std::vector<RegionSummary> summaries;
+        if(g_RecordedFrameCount == 0) {
+            return summaries;
+        }
+
+        const auto last_idx = (g_HistoryIndex + HistoryFrameCount - 1) % HistoryFrameCount;
+        summaries.reserve(g_Regions.size());
+        for(const auto &region: g_Regions) {
+            u64 total_ns = 0;
+            u64 max_ns = 0;
+            size_t hit_count = 0;
+            for(size_t i = 0; i < g_RecordedFrameCount; i++) {
+                const auto ns = region.history_ns[i];
+                if(ns > 0) {
+                    total_ns += ns;
+                    max_ns = std::max(max_ns, ns);
+                    hit_count++;
+                }
+            }
+
+            auto &summary = summaries.emplace_back();
+            summary.name = region.name;
+            summary.last_ms = ToMs(region.history_ns[last_idx]);
+            summary.avg_ms = (hit_count > 0) ? (ToMs(total_ns) / static_cast<double>(hit_count)) : 0.0;
+            summary.max_ms = ToMs(max_ns);
+            std::copy(std::begin(region.bucket_counts), std::end(region.bucket_counts), summary.bucket_counts);
+        }
+        return summaries;
+    }
+
+}